@@ -14,12 +14,33 @@
     before you include this file in *one* C or C++ file to create the
     implementation.
 
+    The implementation uses POSIX threads, so link with pthreads (e.g.
+    `-pthread` with gcc and clang). It needs a POSIX system such as Linux or
+    macOS. Windows, which earlier versions supported through stdio, is not
+    supported anymore: reads and writes go through file descriptors, mmap
+    and pthreads.
+
     ...optionally you can provide the following macros to override defaults:
 
     FS_ASSERT(c)     - your own assert function (default: assert(c))
     FS_MALLOC(s)     - your own malloc function (default: malloc(s))
     FS_FREE(p)       - your own free function (default: free(p))
 
+    FS_NO_IO_URING   - never use io_uring on Linux, batches use threads instead
+
+    ...the implementation relies on POSIX.1-2008 functions (e.g. `pread`) and
+    on the common extensions glibc enables by default (`preadv`, `syscall`).
+    They are visible in the default gcc and clang modes (e.g. `-std=gnu99`).
+    When compiling with a strict mode such as `-std=c99` define
+    `_DEFAULT_SOURCE` before including any system header,
+    `_POSIX_C_SOURCE=200809L` alone is not enough.
+
+    Linux features which glibc only declares with `_GNU_SOURCE` do not need
+    it: `copy_file_range` and io_uring are always called through `syscall()`,
+    and so is `fallocate` when it is not declared. The exception is O_DIRECT, a
+    flag rather than a function: without `_GNU_SOURCE` it is not defined
+    and `fs_read_direct()` reads through the page cache.
+
 
     FEATURE OVERVIEW:
     =================
@@ -28,7 +49,24 @@
     the basics functions for interfacing with a filesystem.
 
     - file reading, appending, and writing
+    - overwriting a byte range in place
+    - zero-copy memory-mapped reading and writing
+    - partial reads of a byte range
+    - scatter reads into multiple buffers
+    - streaming reads in fixed-size chunks
+    - batched reads and writes of many files at once
+    - asynchronous reads on a pool of worker threads
+    - prefetching and access pattern hints
+    - direct reads which bypass the page cache
+    - optional in-memory cache of recently read files
+    - iterating over the lines, or records, of a file
+    - CRC-32C checksums computed while reading
     - creating and deleting files and directories
+    - copying files without passing their contents through memory
+    - asynchronous writes on a background thread
+    - buffered appends to a file which stays open
+    - durable appends from many threads with one sync per batch
+    - lock-free appends of length-prefixed records from many threads
     - retrieving information on files
     - write directory to only allow writes in specific directory
     - search path for searching multiple directories
@@ -41,17 +79,60 @@
     fs_shutdown(void)
     fs_is_valid(void)
 
+    fs_advise(fs_file* file, fs_access access)
+    fs_advise_map(const void* p, size_t size, fs_access access)
     fs_append(const char* name, const fs_data* data)
+    fs_append_async(const char* name, const fs_data* data)
+    fs_appender_close(fs_appender* appender)
+    fs_appender_flush(fs_appender* appender)
+    fs_appender_open(const char* name)
+    fs_appender_reserve(fs_appender* appender, size_t size)
+    fs_appender_write(fs_appender* appender, const fs_data* data)
+    fs_close(fs_file* file)
+    fs_copy(const char* src, const char* dst)
     fs_delete(const char* name)
     fs_exists(const char* path)
+    fs_file_error(const fs_file* file)
+    fs_flush(void)
+    fs_framed_append(fs_framed* framed, const fs_data* data)
+    fs_framed_close(fs_framed* framed)
+    fs_framed_open(const char* name)
     fs_free(void* p)
+    fs_free_aligned(void* p)
     fs_get_cwd()
     fs_get_info(const char* path, fs_info* info)
+    fs_hash(const char* name, uint32_t* hash)
     fs_insert_basepath(const char* path)
+    fs_lines_open(const char* name)
+    fs_log_append(fs_log* log, const fs_data* data)
+    fs_log_close(fs_log* log)
+    fs_log_open(const char* name, long window_us)
+    fs_map(const char* name, size_t* size)
+    fs_map_commit(void* p, size_t size)
+    fs_map_write(const char* name, size_t size)
     fs_mkdir(const char* path)
+    fs_open(const char* name)
+    fs_prefetch(const char* name)
     fs_read(const char* name, size_t* size)
+    fs_read_chunk(fs_file* file, void* buf, size_t size)
+    fs_read_async(const char* name, fs_read_callback callback, void* userdata)
+    fs_read_direct(const char* name, size_t* size)
+    fs_read_hashed(const char* name, size_t* size, uint32_t* hash)
+    fs_read_into(const char* name, void* buf, size_t capacity, size_t* size)
+    fs_read_many(const char* const* names, fs_data* results, int count)
+    fs_read_range(const char* name, size_t offset, size_t length, size_t* size)
+    fs_records_close(fs_records* records)
+    fs_records_error(const fs_records* records)
+    fs_records_next(fs_records* records, fs_data* record)
+    fs_records_open(const char* name, char delim)
+    fs_readv(const char* name, size_t offset, const fs_buffer* buffers, int count, size_t* size)
     fs_remove_basepath(const char* path)
+    fs_unmap(const void* p, size_t size)
     fs_write(const char* name, const fs_data* data)
+    fs_write_async(const char* name, const fs_data* data)
+    fs_write_many(const char* const* names, const fs_data* data, int count, bool sync)
+    fs_write_range(const char* name, size_t offset, const fs_data* data)
+    fs_writev(const char* name, const fs_data* data, int count)
 
 
     STEP BY STEP:
@@ -75,10 +156,81 @@
 
             fs_append(const char* name, fs_data* data)
             fs_write(const char* name, fs_data* data)
+            fs_writev(const char* name, const fs_data* data, int count)
+            fs_write_many(const char* const* names, const fs_data* data, int count, bool sync)
+            fs_write_range(const char* name, size_t offset, const fs_data* data)
+
+    --- to write data to a file without waiting, call:
+
+            fs_write_async(const char* name, const fs_data* data)
+            fs_append_async(const char* name, const fs_data* data)
+            fs_flush()
+
+    --- to append to a file many times, call:
+
+            fs_appender_open(const char* name)
+            fs_appender_reserve(fs_appender* appender, size_t size)
+            fs_appender_write(fs_appender* appender, const fs_data* data)
+            fs_appender_flush(fs_appender* appender)
+            fs_appender_close(fs_appender* appender)
+
+    --- to append records from many threads, call:
+
+            fs_framed_open(const char* name)
+            fs_framed_append(fs_framed* framed, const fs_data* data)
+            fs_framed_close(fs_framed* framed)
+
+    --- to append durably from many threads, call:
+
+            fs_log_open(const char* name, long window_us)
+            fs_log_append(fs_log* log, const fs_data* data)
+            fs_log_close(fs_log* log)
 
     --- to read data from a file, call:
 
             fs_read(const char* name, size_t* size);
+            fs_read_into(const char* name, void* buf, size_t capacity, size_t* size)
+            fs_read_range(const char* name, size_t offset, size_t length, size_t* size)
+            fs_read_many(const char* const* names, fs_data* results, int count)
+            fs_read_async(const char* name, fs_read_callback callback, void* userdata)
+            fs_read_direct(const char* name, size_t* size)
+            fs_readv(const char* name, size_t offset, const fs_buffer* buffers, int count, size_t* size)
+            fs_read_hashed(const char* name, size_t* size, uint32_t* hash)
+
+    --- to compute the checksum of a file, call:
+
+            fs_hash(const char* name, uint32_t* hash)
+
+    --- to read a file in chunks, call:
+
+            fs_open(const char* name)
+            fs_read_chunk(fs_file* file, void* buf, size_t size)
+            fs_file_error(const fs_file* file)
+            fs_close(fs_file* file)
+
+    --- to iterate over the lines, or records, of a file, call:
+
+            fs_lines_open(const char* name)
+            fs_records_open(const char* name, char delim)
+            fs_records_next(fs_records* records, fs_data* record)
+            fs_records_error(const fs_records* records)
+            fs_records_close(fs_records* records)
+
+    --- to map a file into memory without copying, call:
+
+            fs_map(const char* name, size_t* size)
+            fs_unmap(const void* p, size_t size)
+
+    --- to build a file in place in memory, call:
+
+            fs_map_write(const char* name, size_t size)
+            fs_map_commit(void* p, size_t size)
+
+    --- to hint how a file will be accessed, call:
+
+            fs_prefetch(const char* name)
+            fs_advise(fs_file* file, fs_access access)
+            fs_advise_map(const void* p, size_t size, fs_access access)
 
     --- to get information about a file or directory, call:
 
@@ -88,6 +240,10 @@
 
             fs_mkdir(const char* path)
 
+    --- to copy a file into the write directory, call:
+
+            fs_copy(const char* src, const char* dst)
+
     --- to delete a file or directory, call:
 
             fs_delete(const char* name)
@@ -113,6 +269,274 @@
 
         fs_free(data);
 
+    --- When the same file is read over and over, a buffer owned by the user
+        can be filled instead. Nothing is allocated, and if the file does not
+        fit in `capacity` bytes the call fails with `size` set to the size
+        required to read it.
+
+
+        char data[1024];
+        size_t size;
+        if (!fs_read_into("example.txt", data, sizeof(data), &size)) {
+          return -1;
+        }
+
+    --- To read only part of a file, a byte range can be requested. At most
+        `length` bytes starting at `offset` are read, fewer if the end of the
+        file is reached first. Reading past the end of the file fails.
+
+
+        size_t size;
+        const char* header = (char*) fs_read_range("example.bin", 0, 64, &size);
+
+        fs_free(header);
+
+    --- When different parts of a file belong in different buffers, they can
+        be read directly into them in a single call. Starting at `offset`,
+        each buffer is filled in order before moving on to the next one.
+
+
+        char header[64], index[1024];
+        fs_buffer buffers[] = { { header, sizeof(header) }, { index, sizeof(index) } };
+        size_t size;
+        if (!fs_readv("example.bin", 0, buffers, 2, &size)) {
+          return -1;
+        }
+
+    --- When many files are needed at once, they can be read as a batch. On
+        Linux the opens and reads are submitted together through io_uring,
+        elsewhere (or when io_uring is unavailable) a few threads share the
+        work. Each result must be freed like the result of `fs_read()`, files
+        that could not be read have a NULL `data`.
+
+        If io_uring fails while requests are still in flight and they can't
+        be waited for, the batch is read again with threads. The ring, its
+        buffers and the descriptors of the unfinished files are leaked then,
+        since the kernel may still use them.
+
+
+        const char* names[] = { "a.txt", "b.txt", "c.txt" };
+        fs_data results[3];
+        int count = fs_read_many(names, results, 3);
+
+        for (int i = 0; i < 3; i++) {
+          fs_free((void*) results[i].data);
+        }
+
+
+    READING ASYNCHRONOUSLY:
+    =======================
+
+    --- When a read must not block the calling thread, it can be handed to a
+        pool of worker threads which are started on the first asynchronous
+        read. The number of workers is set with `fs_desc.num_threads`
+        (default: 2, at most 8).
+
+        Once the file has been read the callback is called, on a worker
+        thread, with the data (NULL when the file could not be read) which
+        is owned by the user. Reads still pending when `fs_shutdown()` is
+        called are completed before it returns.
+
+
+        void on_read(const char* name, void* data, size_t size, void* userdata) {
+          ...
+          fs_free(data);
+        }
+
+        fs_read_async("example.txt", on_read, NULL);
+
+
+    STREAMING A FILE:
+    =================
+
+    --- When a file is too large to be read at once, it can be opened and
+        read in chunks into a buffer owned by the user. The file is searched
+        for only once, when it is opened. `fs_read_chunk()` returns the number
+        of bytes read, and zero once the end of the file is reached. Zero is
+        also returned when reading fails, which `fs_file_error()` tells
+        apart from the end of the file.
+
+
+        char chunk[4096];
+        fs_file* file = fs_open("example.log");
+        if (!file) {
+          return -1;
+        }
+        size_t n;
+        while ((n = fs_read_chunk(file, chunk, sizeof(chunk))) > 0) {
+          ...
+        }
+        if (fs_file_error(file)) {
+          ...
+        }
+        fs_close(file);
+
+
+    READING RECORDS:
+    ================
+
+    --- Text files are often read one line, or one delimited record, at a
+        time. The file is streamed in chunks, and each record is returned as
+        a view into an internal buffer without the delimiter. The view is
+        only valid until the next call to `fs_records_next()`. When it
+        returns false, `fs_records_error()` tells a failed read apart from
+        the end of the file.
+
+        Delimiters are searched with SSE2 or AVX2 when they are enabled at
+        compile time. A carriage return before a newline is not removed.
+
+
+        fs_records* lines = fs_lines_open("example.txt");
+        fs_data line;
+        while (fs_records_next(lines, &line)) {
+          printf("%.*s\n", (int) line.size, (const char*) line.data);
+        }
+        if (fs_records_error(lines)) {
+          ...
+        }
+        fs_records_close(lines);
+
+
+    CHECKSUMS:
+    ==========
+
+    --- Files can be verified with a CRC-32C (Castagnoli) checksum. Reading a
+        file with `fs_read_hashed()` computes the checksum of each chunk as it
+        is read, while it is still in the cache, instead of going over the
+        whole file a second time. `fs_hash()` computes the checksum without
+        keeping the contents of the file in memory.
+
+        The checksum uses the SSE4.2 or ARMv8 CRC instructions when they are
+        enabled at compile time (e.g. `-msse4.2`), and a table otherwise.
+
+
+        uint32_t hash;
+        size_t size;
+        void* data = fs_read_hashed("example.pak", &size, &hash);
+        if (hash != expected) {
+          ...
+        }
+
+
+    READING DIRECTLY:
+    =================
+
+    --- Large files which are read only once can be read without going
+        through the page cache, so they do not evict data which is still in
+        use (O_DIRECT on Linux, F_NOCACHE on macOS). The memory returned is
+        aligned for direct I/O and must be freed with `fs_free_aligned()`.
+
+        When the filesystem does not support direct I/O, or O_DIRECT is not
+        defined because `_GNU_SOURCE` is not, the file is read normally
+        instead.
+
+
+        size_t size;
+        void* data = fs_read_direct("example.pak", &size);
+
+        fs_free_aligned(data);
+
+
+    READING LARGE FILES:
+    ====================
+
+    --- Fast storage often needs several requests in flight to reach its full
+        bandwidth. When `fs_desc.read_threads` is set, `fs_read()` splits
+        files of 8 MiB or more into ranges which are read concurrently, on up
+        to that many threads (at most 8), into the same buffer.
+
+
+        fs_setup(&(fs_desc) {
+          .base_paths = { "data" },
+          .read_threads = 4,
+        });
+
+
+    CACHING READS:
+    ==============
+
+    --- When `fs_desc.cache_size` is set, files read with `fs_read()` are kept
+        in memory, up to that many bytes in total, and the least recently
+        used files are evicted first. A file is read again when its size or
+        modification time has changed since it was cached.
+
+        On a cache hit no memory is allocated, instead every reader of the
+        file shares the same buffer. Memory returned by `fs_read()` must then
+        be treated as read-only, and is released with `fs_free()` as usual.
+
+
+        fs_setup(&(fs_desc) {
+          .base_paths = { "data" },
+          .cache_size = 16 * 1024 * 1024,
+        });
+
+
+    MAPPING A FILE:
+    ===============
+
+    --- When mapping a file, the file is resolved through the search path
+        just like `fs_read()`, but instead of copying its contents into
+        allocated memory a read-only view of the file is returned.
+
+        Pages are only loaded when they are touched, and are shared with
+        any other process mapping the same file. The view must be released
+        with `fs_unmap()` using the size returned by `fs_map()`. Empty files
+        cannot be mapped.
+
+
+        size_t size;
+        const char* data = (const char*) fs_map("example.txt", &size);
+
+        fs_unmap(data, size);
+
+    --- Large outputs can be built directly in the page cache instead of in
+        an allocated buffer. `fs_map_write()` creates, or replaces, a file of
+        `size` bytes in the write directory and returns a writable view of
+        it, initially filled with zeros. Everything written to the view ends
+        up in the file.
+
+        `fs_map_commit()` waits until the contents are written to the file
+        (msync) and releases the view. The file is allocated up front where
+        the filesystem supports it, since running out of space while writing
+        to a view crashes the program instead of returning an error. When
+        there is not enough space `fs_map_write()` returns NULL, and removes
+        the file if it did not exist before.
+
+
+        char* out = (char*) fs_map_write("example.bin", 4096);
+        if (!out) {
+          return -1;
+        }
+        memcpy(out, header, sizeof(header));
+        fs_map_commit(out, 4096);
+
+
+    ACCESS HINTS:
+    =============
+
+    --- When it is known ahead of time that a file will be read, it can be
+        prefetched so that it is already in the page cache when it is read.
+        Prefetching returns immediately and does not allocate any memory.
+
+        Files opened with `fs_open()` and files mapped with `fs_map()` can
+        be given a hint on how they will be accessed:
+
+        FS_ACCESS_NORMAL      - no particular access pattern
+        FS_ACCESS_SEQUENTIAL  - read from beginning to end, read ahead more
+        FS_ACCESS_RANDOM      - read in no particular order, do not read ahead
+        FS_ACCESS_WILLNEED    - will be read soon, start loading it now
+        FS_ACCESS_DONTNEED    - will not be read again soon, release it
+
+        Hints are only advice, and are ignored where they are not supported.
+        On Linux FS_ACCESS_DONTNEED has no effect on mapped files, glibc's
+        `posix_madvise()` ignores it.
+
+
+        fs_prefetch("level2.bin");
+
+        fs_file* file = fs_open("level1.bin");
+        fs_advise(file, FS_ACCESS_SEQUENTIAL);
+
 
     WRITTING TO A FILE:
     ===================
@@ -129,6 +553,138 @@
           return -1;
         }
 
+    --- To change part of a file without rewriting all of it, data can be
+        written at an offset. The rest of the file is left as it is, and the
+        file grows when the data ends past its end. A file that doesn't
+        exist is created, with zeros before `offset`.
+
+
+        const char* version = "v2";
+        if (!fs_write_range("example.bin", 4, FS_DATA_STR_REF(version))) {
+          return -1;
+        }
+
+    --- When many files are written at once, they can be written as a
+        batch. Like `fs_read_many()` the opens and writes are submitted
+        together through io_uring on Linux, and shared by a few threads
+        elsewhere. When `sync` is true each file is also flushed to the
+        device before the call returns (on io_uring the fsync is linked to
+        the write). The number of files written is returned. Like
+        `fs_read_many()`, a ring which fails with requests in flight is
+        leaked together with the descriptors of the unfinished files.
+
+
+        const char* names[] = { "chunk0.bin", "chunk1.bin" };
+        fs_data chunks[] = { { chunk0, size0 }, { chunk1, size1 } };
+        if (fs_write_many(names, chunks, 2, true) != 2) {
+          return -1;
+        }
+
+    --- When the contents of a file are made of several pieces, e.g. a
+        header, a body and a footer, they can be written in a single call
+        without first copying them into one buffer.
+
+
+        fs_data parts[] = { { header, header_size }, { body, body_size } };
+        if (!fs_writev("example.bin", parts, 2)) {
+          return -1;
+        }
+
+    --- When appending small pieces of data often, opening and closing the
+        file every time costs more than the write itself. An appender keeps
+        the file open and collects appended data in a buffer, which is
+        written to the file when it is full, flushed, or closed. When that
+        write fails, whatever could not be written stays in the buffer and is
+        written by the next flush.
+
+        When the final size is known ahead of time, the space can be
+        reserved up front (with fallocate on Linux) so the file is not
+        fragmented as it grows. The size of the file does not change until
+        data is appended. Files of 1 MiB or more written with `fs_write()`
+        are reserved the same way.
+
+        An appender must not be used by more than one thread at a time.
+
+
+        fs_appender* log = fs_appender_open("example.log");
+        fs_appender_reserve(log, 1024 * 1024);
+        fs_appender_write(log, FS_DATA_STR_REF(text));
+        fs_appender_flush(log);
+        fs_appender_close(log);
+
+    --- When many threads append records to the same file, they can share
+        a framed file instead of taking turns behind a lock. Each record is
+        written as a 4-byte little-endian length followed by its contents,
+        in a single write to a file opened with O_APPEND, so records from
+        different threads never interleave.
+
+        Records are limited to `FS_MAX_RECORD` bytes (4096), larger records
+        are refused. Nothing is buffered, every record is a system call.
+
+
+        fs_framed* events = fs_framed_open("events.bin");
+        fs_framed_append(events, &(fs_data) { &event, sizeof(event) });
+        fs_framed_close(events);
+
+    --- When appended data must survive a crash, every append has to wait
+        for the data to reach the device, and syncing the file after every
+        append is very slow. A log lets many threads append at once:
+        appends which arrive while a batch is being synced are written
+        together with a single `writev`, followed by a single `fdatasync`.
+
+        The first append of a batch waits `window_us` microseconds for
+        others to join before writing it, trading latency for larger
+        batches. `fs_log_append()` returns once its data is on the device.
+        After a failed write every append fails. `fs_log_open()` also
+        syncs the directory of a new log, so the file itself survives a
+        crash, and on macOS the data is flushed with `F_FULLFSYNC`.
+
+
+        fs_log* journal = fs_log_open("journal.log", 200);
+        fs_log_append(journal, FS_DATA_STR_REF(text));
+        fs_log_close(journal);
+
+
+    WRITING ASYNCHRONOUSLY:
+    =======================
+
+    --- When a write must not block the calling thread, its data can be
+        copied and handed to a background thread which is started on the
+        first asynchronous write. Writes are completed in the order they
+        were made, so appends to the same file keep their order.
+
+        Once `fs_desc.write_limit` bytes (default: 16 MiB) are waiting to
+        be written, further writes block until there is room again. Errors
+        are reported by `fs_flush()`, which waits for every pending write.
+        Pending writes are also completed before `fs_shutdown()` returns.
+
+
+        fs_write_async("save.dat", &(fs_data) { state, state_size });
+        ...
+        if (!fs_flush()) {
+          return -1;
+        }
+
+
+    COPYING A FILE:
+    ===============
+
+    --- When copying, the source file is searched for in the search path and
+        the copy is written to the write directory, replacing any existing
+        file. The contents are copied by the kernel (copy_file_range, then
+        sendfile, on Linux) and only go through a buffer in memory when that
+        is not possible. Copying a file onto itself fails and leaves it
+        untouched.
+
+        On copy-on-write filesystems (e.g. btrfs, XFS) the copy is a clone
+        which shares the data of the source until either file is modified,
+        so no data is copied at all.
+
+
+        if (!fs_copy("defaults.cfg", "user.cfg")) {
+          return -1;
+        }
+
 
     LICENSE:
     ========
@@ -159,6 +715,7 @@
 
 #include <stdbool.h>
 #include <stddef.h> /* size_t */
+#include <stdint.h> /* uint32_t */
 
 #if !defined (FS_API_DECL)
   #define FS_API_DECL extern
@@ -181,10 +738,17 @@ typedef struct fs_data {
   #define FS_DATA_STR_REF(x) &(fs_data) { x, strlen(x) }
 #endif
 
+/* a writable region of memory */
+typedef struct fs_buffer {
+  void* data;
+  size_t size;
+} fs_buffer;
+
 /* compile-time constants */
 enum {
   FS_MAX_PATH = 256,
   FS_MAX_MOUNTS = 3,
+  FS_MAX_RECORD = 4096,   /* largest record appended with `fs_framed_append()` */
 };
 
 typedef enum fs_file_type {
@@ -194,15 +758,45 @@ typedef enum fs_file_type {
   FS_FILETYPE_SYM,
 } fs_file_type;
 
+typedef enum fs_access {
+  FS_ACCESS_NORMAL,
+  FS_ACCESS_SEQUENTIAL,
+  FS_ACCESS_RANDOM,
+  FS_ACCESS_WILLNEED,
+  FS_ACCESS_DONTNEED,
+} fs_access;
+
 typedef struct fs_info {
   fs_file_type type;
   size_t size;
   long int modtime;
 } fs_info;
 
+/* opaque handle to a file opened with `fs_appender_open()` */
+typedef struct fs_appender fs_appender;
+
+/* opaque handle to a file opened with `fs_framed_open()` */
+typedef struct fs_framed fs_framed;
+
+/* opaque handle to a file opened with `fs_log_open()` */
+typedef struct fs_log fs_log;
+
+/* opaque handle to a file opened with `fs_records_open()` */
+typedef struct fs_records fs_records;
+
+/* called from a worker thread once an asynchronous read has completed */
+typedef void (*fs_read_callback)(const char* name, void* data, size_t size, void* userdata);
+
+/* opaque handle to a file opened with `fs_open()` */
+typedef struct fs_file fs_file;
+
 typedef struct fs_desc {
   const char* write_dir;
   const char* base_paths[3];
+  int num_threads;      /* worker threads for asynchronous reads (default: 2) */
+  size_t cache_size;    /* bytes of file contents cached by `fs_read()` (default: 0, disabled) */
+  int read_threads;     /* threads reading large files in `fs_read()` (default: 1) */
+  size_t write_limit;   /* bytes queued by asynchronous writes before they block (default: 16 MiB) */
 } fs_desc;
 
 /* setup filesystem */
@@ -219,20 +813,106 @@ FS_API_DECL bool fs_remove_basepath(const char* path);
 FS_API_DECL bool fs_exists(const char* path);
 /* reads the contents of a file */
 FS_API_DECL void* fs_read(const char* name, size_t* size);
+/* reads the contents of a file bypassing the page cache */
+FS_API_DECL void* fs_read_direct(const char* name, size_t* size);
+/* reads the contents of a file and computes its CRC-32C checksum */
+FS_API_DECL void* fs_read_hashed(const char* name, size_t* size, uint32_t* hash);
+/* computes the CRC-32C checksum of a file */
+FS_API_DECL bool fs_hash(const char* name, uint32_t* hash);
+/* reads the contents of a file into a user provided buffer */
+FS_API_DECL bool fs_read_into(const char* name, void* buf, size_t capacity, size_t* size);
+/* reads a byte range of a file */
+FS_API_DECL void* fs_read_range(const char* name, size_t offset, size_t length, size_t* size);
+/* reads the contents of many files, returns the number of files read */
+FS_API_DECL int fs_read_many(const char* const* names, fs_data* results, int count);
+/* reads the contents of a file on a worker thread */
+FS_API_DECL bool fs_read_async(const char* name, fs_read_callback callback, void* userdata);
+/* reads part of a file into multiple buffers */
+FS_API_DECL bool fs_readv(const char* name, size_t offset, const fs_buffer* buffers, int count, size_t* size);
+/* opens a file for reading in chunks */
+FS_API_DECL fs_file* fs_open(const char* name);
+/* reads the next chunk of a file, returns zero at the end of the file or on error */
+FS_API_DECL size_t fs_read_chunk(fs_file* file, void* buf, size_t size);
+/* true once reading a file opened with `fs_open()` has failed */
+FS_API_DECL bool fs_file_error(const fs_file* file);
+/* closes a file opened with `fs_open()` */
+FS_API_DECL void fs_close(fs_file* file);
+/* opens a file for reading records separated by `delim` */
+FS_API_DECL fs_records* fs_records_open(const char* name, char delim);
+/* opens a file for reading lines */
+FS_API_DECL fs_records* fs_lines_open(const char* name);
+/* reads the next record of a file, returns false at the end of the file or on error */
+FS_API_DECL bool fs_records_next(fs_records* records, fs_data* record);
+/* true once reading a file opened with `fs_records_open()` has failed */
+FS_API_DECL bool fs_records_error(const fs_records* records);
+/* closes a file opened with `fs_records_open()` */
+FS_API_DECL void fs_records_close(fs_records* records);
+/* starts loading a file into the page cache */
+FS_API_DECL bool fs_prefetch(const char* name);
+/* hints how a file opened with `fs_open()` will be accessed */
+FS_API_DECL bool fs_advise(fs_file* file, fs_access access);
+/* hints how memory mapped by `fs_map()` will be accessed */
+FS_API_DECL bool fs_advise_map(const void* p, size_t size, fs_access access);
+/* maps the contents of a file into memory as read-only */
+FS_API_DECL const void* fs_map(const char* name, size_t* size);
+/* releases memory mapped by `fs_map()` */
+FS_API_DECL void fs_unmap(const void* p, size_t size);
+/* creates a file of `size` bytes in the write directory and maps it into memory for writing */
+FS_API_DECL void* fs_map_write(const char* name, size_t size);
+/* flushes a mapping returned by `fs_map_write()` to the file and releases it */
+FS_API_DECL bool fs_map_commit(void* p, size_t size);
 /* writes data to a file */
 FS_API_DECL bool fs_write(const char* name, const fs_data* data);
+/* writes many files in the write directory at once, optionally syncing them, returns the number written */
+FS_API_DECL int fs_write_many(const char* const* names, const fs_data* data, int count, bool sync);
+/* overwrites part of a file in the write directory starting at `offset`, keeping the rest */
+FS_API_DECL bool fs_write_range(const char* name, size_t offset, const fs_data* data);
+/* writes several pieces of data to a file in the write directory, one after the other */
+FS_API_DECL bool fs_writev(const char* name, const fs_data* data, int count);
 /* writes data to the end of a file */
 FS_API_DECL bool fs_append(const char* name, const fs_data* data);
+/* copies data and writes it to a file on a background thread */
+FS_API_DECL bool fs_write_async(const char* name, const fs_data* data);
+/* copies data and writes it to the end of a file on a background thread */
+FS_API_DECL bool fs_append_async(const char* name, const fs_data* data);
+/* waits until every asynchronous write has completed, false if any failed */
+FS_API_DECL bool fs_flush(void);
+/* opens a file for appending many times */
+FS_API_DECL fs_appender* fs_appender_open(const char* name);
+/* appends data to a file opened with `fs_appender_open()` */
+FS_API_DECL bool fs_appender_write(fs_appender* appender, const fs_data* data);
+/* writes buffered data to the file */
+FS_API_DECL bool fs_appender_flush(fs_appender* appender);
+/* allocates space for `size` more bytes in a file opened with `fs_appender_open()` */
+FS_API_DECL bool fs_appender_reserve(fs_appender* appender, size_t size);
+/* flushes and closes a file opened with `fs_appender_open()` */
+FS_API_DECL bool fs_appender_close(fs_appender* appender);
+/* opens a file in the write directory for appending records from many threads */
+FS_API_DECL fs_framed* fs_framed_open(const char* name);
+/* appends a length-prefixed record in a single write, safe to call from any thread */
+FS_API_DECL bool fs_framed_append(fs_framed* framed, const fs_data* data);
+/* closes a file opened with `fs_framed_open()` */
+FS_API_DECL bool fs_framed_close(fs_framed* framed);
+/* opens a file in the write directory for durable appends from many threads */
+FS_API_DECL fs_log* fs_log_open(const char* name, long window_us);
+/* appends data to a log, returns once it is on the device */
+FS_API_DECL bool fs_log_append(fs_log* log, const fs_data* data);
+/* closes a file opened with `fs_log_open()` */
+FS_API_DECL bool fs_log_close(fs_log* log);
 /* gets information about the specified file or directory */
 FS_API_DECL bool fs_get_info(const char* path, fs_info* info);
 /* gets the current working directory */
 FS_API_DECL const char* fs_get_cwd();
 /* creates a directory */
 FS_API_DECL bool fs_mkdir(const char* path);
+/* copies a file from the search path to the write directory */
+FS_API_DECL bool fs_copy(const char* src, const char* dst);
 /* deletes a file or directory */
 FS_API_DECL bool fs_delete(const char* name);
 /* frees allocated memory */
 FS_API_DECL inline void fs_free(void* p);
+/* frees memory returned by `fs_read_direct()` */
+FS_API_DECL void fs_free_aligned(void* p);
 
 #ifdef __cplusplus
 }
@@ -252,22 +932,51 @@ inline bool fs_append(const char* name, fs_data &data) { return fs_append(name,
 
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <sys/stat.h>
 #include <errno.h>
 
-#if defined (_WIN32)
-  #ifndef WIN32_LEAN_AND_MEAN
-  #define WIN32_LEAN_AND_MEAN
+#if defined(_WIN32)
+  #error "filesystem.h: Windows is not supported, see the top of this file"
+#endif
+#if defined(__GLIBC__) && !defined(_DEFAULT_SOURCE)
+  #error "filesystem.h: define _DEFAULT_SOURCE when compiling with a strict mode such as -std=c99"
+#endif
+
+#include <sys/param.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#if defined(__AVX2__)
+  #include <immintrin.h>
+#elif defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+#if defined(__SSE4_2__)
+  #include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+  #include <arm_acle.h>
+#endif
+
+#if defined(__linux__)
+  #include <sys/syscall.h>
+  #include <sys/sendfile.h>
+  #include <sys/ioctl.h>
+  #include <linux/falloc.h>
+  #if !defined(FICLONE)
+    #define FICLONE _IOW(0x94, 9, int)
   #endif
-  #ifndef NOMINMAX
-  #define NOMINMAX
+#endif
+
+#if defined(__linux__) && !defined(FS_NO_IO_URING)
+  #include <linux/io_uring.h>
+  #if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+    #define _FS_IO_URING (1)
   #endif
-  #include <windows.h>
-  #include <direct.h>
-  #define _getcwd getcwd
-#else
-  #include <sys/param.h>
-  #include <unistd.h>
 #endif
 
 #ifndef _FS_PRIVATE
@@ -293,17 +1002,162 @@ enum {
   _FS_MREAD,
   _FS_MWRITE,
   _FS_MAPPEND,
+  _FS_MREADWRITE,
+  _FS_MUPDATE,
+  _FS_MCREATE,
+};
+
+enum {
+  _FS_COPY_RANGE,
+  _FS_COPY_SENDFILE,
+  _FS_COPY_BUFFER,
+};
+
+enum {
+  _FS_MAX_THREADS = 8,
+  _FS_DEFAULT_THREADS = 2,
+  _FS_URING_ENTRIES = 64,
+  _FS_DIRECT_ALIGN = 4096,
+  _FS_CACHE_BUCKETS = 1024,
+  _FS_RECORDS_CHUNK = 64 * 1024,
+  _FS_MAX_IOV = 64,
+  _FS_COPY_CHUNK = 1024 * 1024,
+  _FS_PARALLEL_MIN = 8 * 1024 * 1024,
+  _FS_PARALLEL_CHUNK = 2 * 1024 * 1024,
+  _FS_HASH_CHUNK = 256 * 1024,
+  _FS_APPEND_BUFFER = 64 * 1024,
+  _FS_DEFAULT_WRITE_LIMIT = 16 * 1024 * 1024,
+  _FS_PREALLOC_MIN = 1024 * 1024,
 };
 
+#define _fs_def(val, def) (((val) == 0) ? (def) : (val))
+
 typedef struct {
   char buf[FS_MAX_PATH];
 } _fs_path;
 
+struct fs_file {
+  int fd;
+  bool error;
+};
+
+struct fs_appender {
+  int fd;
+  size_t size;
+  char buf[_FS_APPEND_BUFFER];
+};
+
+struct fs_framed {
+  int fd;
+};
+
+struct fs_log {
+  int fd;
+  long window_us;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  fs_data* records;     /* records of the open batch, owned by the waiting callers */
+  int count;
+  int capacity;
+  fs_data* spare;       /* records of the batch being written */
+  int spare_capacity;
+  uint64_t batch;       /* the open batch */
+  uint64_t durable;     /* every batch up to this one is on the device */
+  bool syncing;         /* a caller is writing a batch */
+  uint64_t failed;      /* the first batch which could not be written, zero if none */
+};
+
+struct fs_records {
+  int fd;
+  char delim;
+  bool eof;
+  bool error;
+  char* buf;
+  size_t capacity;
+  size_t start;   /* start of the next record */
+  size_t scan;    /* bytes before this have no delimiter */
+  size_t end;     /* end of the bytes read */
+};
+
+/* a copy of the search path, taken so it can be used without holding the lock */
+typedef struct {
+  int count;
+  _fs_path base_path[FS_MAX_MOUNTS];
+} _fs_search_t;
+
+typedef struct _fs_job_t {
+  struct _fs_job_t* next;
+  char name[FS_MAX_PATH];
+  fs_read_callback callback;
+  void* userdata;
+} _fs_job_t;
+
+typedef struct {
+  pthread_t threads[_FS_MAX_THREADS];
+  int num_threads;
+  int started;
+  _fs_job_t* head;
+  _fs_job_t* tail;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  bool stop;
+} _fs_pool_t;
+
+typedef struct _fs_write_job_t {
+  struct _fs_write_job_t* next;
+  char path[FS_MAX_PATH];
+  int mode;
+  fs_data data;                         /* copied, stored after the job */
+} _fs_write_job_t;
+
+typedef struct {
+  pthread_t thread;
+  bool started;
+  _fs_write_job_t* head;
+  _fs_write_job_t* tail;
+  size_t pending;                       /* bytes queued or being written */
+  int jobs;                             /* jobs queued or being written, some may be empty */
+  size_t limit;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;                  /* signaled when a job is queued */
+  pthread_cond_t done;                  /* signaled when a job is written */
+  bool stop;
+  bool failed;
+} _fs_writer_t;
+
+typedef struct _fs_cache_entry_t {
+  struct _fs_cache_entry_t* prev;       /* least recently used order */
+  struct _fs_cache_entry_t* next;
+  struct _fs_cache_entry_t* path_next;  /* hash chain by path */
+  struct _fs_cache_entry_t* data_next;  /* hash chain by data pointer */
+  char path[FS_MAX_PATH];
+  void* data;
+  size_t size;
+  long long modtime;
+  int refs;
+  bool cached;                          /* false once evicted while still in use */
+} _fs_cache_entry_t;
+
+typedef struct {
+  size_t capacity;
+  size_t total;
+  _fs_cache_entry_t* head;
+  _fs_cache_entry_t* tail;
+  _fs_cache_entry_t* by_path[_FS_CACHE_BUCKETS];
+  _fs_cache_entry_t* by_data[_FS_CACHE_BUCKETS];
+  pthread_mutex_t lock;
+} _fs_cache_t;
+
 typedef struct {
   int count;
   _fs_path base_path[FS_MAX_PATH];
   _fs_path write_dir;
   char cwd[FS_MAX_PATH];
+  pthread_mutex_t lock;
+  _fs_pool_t pool;
+  _fs_writer_t writer;
+  _fs_cache_t cache;
+  int read_threads;
   bool valid;
 } _fs_state_t;
 static _fs_state_t _fs;
@@ -379,126 +1233,2054 @@ _FS_PRIVATE bool _fs_native_mkdir(const char* path) {
   return true;
 }
 
-_FS_PRIVATE FILE* _fs_native_open(const char* filename, int mode) {
-  if ((mode == _FS_MREAD) && !_fs_get_file_info(filename, NULL)) {
-    return NULL;
-  }
-  if ((mode == _FS_MAPPEND || mode == _FS_MWRITE) && _fs_strempty(&_fs.write_dir)) {
-    return NULL;
+_FS_PRIVATE int _fs_native_open(const char* filename, int mode) {
+  if (mode != _FS_MREAD && _fs_strempty(&_fs.write_dir)) {
+    return -1;
   }
-  FILE* fp = NULL;
+  int fd = -1;
   switch (mode) {
-  case _FS_MREAD: fp = fopen(filename, "rb"); break;
-  case _FS_MAPPEND: fp = fopen(filename, "a"); break;
-  case _FS_MWRITE: fp = fopen(filename, "wb"); break;
+  case _FS_MREAD: fd = open(filename, O_RDONLY); break;
+  case _FS_MAPPEND: fd = open(filename, O_WRONLY | O_CREAT | O_APPEND, 0666); break;
+  case _FS_MWRITE: fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666); break;
+  case _FS_MREADWRITE: fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0666); break;
+  case _FS_MUPDATE: fd = open(filename, O_WRONLY | O_CREAT, 0666); break;
+  case _FS_MCREATE: fd = open(filename, O_WRONLY | O_CREAT | O_EXCL, 0666); break;
   }
-  return (!fp) ? NULL : fp;
+  return fd;
 }
 
-_FS_PRIVATE void* _fs_native_read(FILE* fp, size_t* size) {
-  if (fp == NULL) {
-    return NULL;
-  }
-  fseek(fp, 0, SEEK_END);
-  *size = ftell(fp);
-  fseek(fp, 0, SEEK_SET);
-  void* buf = FS_MALLOC(*size);
-  if (!buf) {
-    return NULL;
+/* like `_fs_get_file_info()` on an opened file but with the modification time in nanoseconds */
+_FS_PRIVATE bool _fs_native_stat(int fd, size_t* size, long long* modtime) {
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    return false;
   }
-  fread(buf, 1, *size, fp);
-  fclose(fp);
-  return buf;
+  *size = (size_t)st.st_size;
+#if defined(__APPLE__)
+  *modtime = (long long)st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+  *modtime = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+  return true;
 }
 
-_FS_PRIVATE int _fs_native_write(FILE* fp, const fs_data* data) {
-  if (fp == NULL) {
-    return false;
-  }
-  size_t size = fwrite((char*)(data->data), sizeof(char), data->size, fp);
-  fclose(fp);
-  return size == data->size;
+_FS_PRIVATE void _fs_search_path(_fs_search_t* search) {
+  pthread_mutex_lock(&_fs.lock);
+  search->count = (_fs.count < FS_MAX_MOUNTS) ? _fs.count : FS_MAX_MOUNTS;
+  memcpy(search->base_path, _fs.base_path, search->count * sizeof(_fs_path));
+  pthread_mutex_unlock(&_fs.lock);
 }
 
-/* public api functions */
+/* only a name which isn't there moves on to the next entry in the search path, any other
+   error stops the search so a lower-priority file of the same name is never used instead */
+_FS_PRIVATE bool _fs_resolve_next(int err) {
+  return err == ENOENT || err == ENOTDIR;
+}
 
-void fs_setup(const fs_desc* desc) {
-  FS_ASSERT(desc);
-  _fs_strcpy(&_fs.write_dir, desc->write_dir);
-  for (int i = 0; i < FS_MAX_MOUNTS; i++) {
-    if (desc->base_paths[i]) {
-      _fs_strcpy(&_fs.base_path[i], desc->base_paths[i]);
-      _fs.count++;  
+/* opens the first file named `name` found in the search path, storing its path in `buf` */
+_FS_PRIVATE int _fs_resolve_open_path(const char* name, char* buf) {
+  _fs_search_t search;
+  _fs_search_path(&search);
+  _fs_path* dir = &search.base_path[search.count - 1];
+  for (; dir >= search.base_path; dir--) {
+    if (!_fs_concat_path(buf, dir, name)) {
+      continue;
+    }
+    int fd = _fs_native_open(buf, _FS_MREAD);
+    if (fd >= 0 || !_fs_resolve_next(errno)) {
+      return fd;
     }
   }
-  /* always last */
-  _fs.valid = true;
+  return -1;
 }
 
-void fs_shutdown(void) {
-  FS_ASSERT(_fs.valid);
-  _fs.valid = false;
+_FS_PRIVATE int _fs_resolve_open(const char* name) {
+  char buf[FS_MAX_PATH];
+  return _fs_resolve_open_path(name, buf);
 }
 
-bool fs_is_valid(void) {
-  return _fs.valid;
-}
+_FS_PRIVATE bool _fs_native_size(int fd, size_t* size) {
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    return false;
+  }
+  *size = (size_t)st.st_size;
+  return true;
+}
+
+/* the pointer returned by FS_MALLOC is stored right before the aligned block */
+_FS_PRIVATE void* _fs_malloc_aligned(size_t size, size_t align) {
+  char* p = (char*)FS_MALLOC(size + align + sizeof(void*));
+  if (!p) {
+    return NULL;
+  }
+  uintptr_t addr = ((uintptr_t)(p + sizeof(void*)) + align - 1) & ~(uintptr_t)(align - 1);
+  ((void**)addr)[-1] = p;
+  return (void*)addr;
+}
+
+_FS_PRIVATE void _fs_free_aligned(void* p) {
+  if (p != NULL) {
+    FS_FREE(((void**)p)[-1]);
+  }
+}
+
+/* reads until `size` bytes are read, end of file, or an error */
+_FS_PRIVATE bool _fs_native_read_all(int fd, void* buf, size_t size, size_t* count) {
+  char* p = (char*)buf;
+  *count = 0;
+  while (*count < size) {
+    ssize_t n = read(fd, p + *count, size - *count);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      return false;
+    }
+    if (n == 0) {
+      break;
+    }
+    *count += (size_t)n;
+  }
+  return true;
+}
+
+_FS_PRIVATE bool _fs_native_pread_all(int fd, void* buf, size_t size, size_t offset, size_t* count) {
+  char* p = (char*)buf;
+  *count = 0;
+  while (*count < size) {
+    ssize_t n = pread(fd, p + *count, size - *count, (off_t)(offset + *count));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      return false;
+    }
+    if (n == 0) {
+      break;
+    }
+    *count += (size_t)n;
+  }
+  return true;
+}
+
+/* like `_fs_native_pread_all()` but filling each buffer in turn */
+_FS_PRIVATE bool _fs_native_preadv_all(int fd, const fs_buffer* bufs, int count, size_t offset, size_t* total) {
+  struct iovec iov[_FS_MAX_IOV];
+  int i = 0;
+  size_t skip = 0;
+  *total = 0;
+  for (;;) {
+    while (i < count && bufs[i].size == skip) {
+      i++;
+      skip = 0;
+    }
+    if (i == count) {
+      break;
+    }
+    int n = 0;
+    for (; n < _FS_MAX_IOV && i + n < count; n++) {
+      iov[n].iov_base = (char*)bufs[i + n].data;
+      iov[n].iov_len = bufs[i + n].size;
+    }
+    iov[0].iov_base = (char*)iov[0].iov_base + skip;
+    iov[0].iov_len -= skip;
+    ssize_t ret = preadv(fd, iov, n, (off_t)(offset + *total));
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret < 0) {
+      return false;
+    }
+    if (ret == 0) {
+      break;
+    }
+    *total += (size_t)ret;
+    for (size_t left = (size_t)ret; left > 0; ) {
+      size_t avail = bufs[i].size - skip;
+      if (left < avail) {
+        skip += left;
+        break;
+      }
+      left -= avail;
+      i++;
+      skip = 0;
+    }
+  }
+  return true;
+}
+
+/* like `_fs_native_write_all()` but also returns how much was written when it fails */
+_FS_PRIVATE bool _fs_native_write_count(int fd, const void* buf, size_t size, size_t* count) {
+  const char* p = (const char*)buf;
+  *count = 0;
+  while (*count < size) {
+    ssize_t n = write(fd, p + *count, size - *count);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    *count += (size_t)n;
+  }
+  return true;
+}
+
+_FS_PRIVATE bool _fs_native_write_all(int fd, const void* buf, size_t size) {
+  size_t count;
+  return _fs_native_write_count(fd, buf, size, &count);
+}
+
+_FS_PRIVATE bool _fs_native_pwrite_all(int fd, const void* buf, size_t size, size_t offset) {
+  const char* p = (const char*)buf;
+  while (size > 0) {
+    ssize_t n = pwrite(fd, p, size, (off_t)offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    size -= (size_t)n;
+    offset += (size_t)n;
+  }
+  return true;
+}
+
+/* like `_fs_native_write_all()` but writing each segment in turn */
+_FS_PRIVATE bool _fs_native_writev_all(int fd, const fs_data* segs, int count) {
+  struct iovec iov[_FS_MAX_IOV];
+  int i = 0;
+  size_t skip = 0;
+  for (;;) {
+    while (i < count && segs[i].size == skip) {
+      i++;
+      skip = 0;
+    }
+    if (i == count) {
+      return true;
+    }
+    int n = 0;
+    for (; n < _FS_MAX_IOV && i + n < count; n++) {
+      iov[n].iov_base = (void*)segs[i + n].data;
+      iov[n].iov_len = segs[i + n].size;
+    }
+    iov[0].iov_base = (char*)iov[0].iov_base + skip;
+    iov[0].iov_len -= skip;
+    ssize_t ret = writev(fd, iov, n);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      return false;
+    }
+    for (size_t left = (size_t)ret; left > 0; ) {
+      size_t avail = segs[i].size - skip;
+      if (left < avail) {
+        skip += left;
+        break;
+      }
+      left -= avail;
+      i++;
+      skip = 0;
+    }
+  }
+}
+
+/* allocates `size` bytes past the end of a file without changing its size, returns 0 or an errno value */
+_FS_PRIVATE int _fs_native_reserve(int fd, size_t size) {
+  /* glibc only declares `fallocate` with _GNU_SOURCE, 64-bit targets call the kernel directly without it */
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE) && (defined(_GNU_SOURCE) || (defined(__NR_fallocate) && defined(__LP64__)))
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    return errno;
+  }
+  int ret;
+#if defined(_GNU_SOURCE)
+  while ((ret = fallocate(fd, FALLOC_FL_KEEP_SIZE, st.st_size, (off_t)size)) < 0 && errno == EINTR);
+#else
+  while ((ret = (int)syscall(__NR_fallocate, fd, FALLOC_FL_KEEP_SIZE, (long)st.st_size, (long)size)) < 0 && errno == EINTR);
+#endif
+  return (ret == 0) ? 0 : errno;
+#else
+  (void)fd;
+  (void)size;
+  return EOPNOTSUPP;
+#endif
+}
+
+/* flushes the contents of a file, but not necessarily its metadata, to the device */
+_FS_PRIVATE bool _fs_native_sync(int fd) {
+#if defined(__APPLE__)
+  /* fsync leaves the data in the drive's cache, not every filesystem supports a full sync */
+  return fcntl(fd, F_FULLFSYNC) == 0 || fsync(fd) == 0;
+#else
+  int ret;
+  while ((ret = fdatasync(fd)) < 0 && errno == EINTR);
+  return ret == 0;
+#endif
+}
+
+/* flushes the directory entry of a file to the device, so a new file survives a crash */
+_FS_PRIVATE bool _fs_native_sync_dir(const char* filename) {
+  char dir[FS_MAX_PATH];
+  strcpy(dir, filename);
+  char* sep = strrchr(dir, '/');
+  if (sep == dir) {
+    sep++;
+  }
+  if (sep) {
+    *sep = '\0';
+  } else {
+    strcpy(dir, ".");
+  }
+#if defined(O_DIRECTORY)
+  int fd = open(dir, O_RDONLY | O_DIRECTORY);
+#else
+  int fd = open(dir, O_RDONLY);
+#endif
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = fsync(fd) == 0;
+  close(fd);
+  return ok;
+}
+
+/* runs `fn` for every index in [0, count) on up to `threads` threads */
+typedef struct {
+  void (*fn)(void* ctx, int i);
+  void* ctx;
+  int count;
+  int next;
+  pthread_mutex_t lock;
+} _fs_parallel_t;
+
+_FS_PRIVATE void* _fs_parallel_worker(void* arg) {
+  _fs_parallel_t* job = (_fs_parallel_t*)arg;
+  for (;;) {
+    pthread_mutex_lock(&job->lock);
+    int i = job->next++;
+    pthread_mutex_unlock(&job->lock);
+    if (i >= job->count) {
+      break;
+    }
+    job->fn(job->ctx, i);
+  }
+  return NULL;
+}
+
+_FS_PRIVATE void _fs_parallel_for(int count, int threads, void (*fn)(void*, int), void* ctx) {
+  _fs_parallel_t job = { .fn = fn, .ctx = ctx, .count = count, .next = 0, .lock = PTHREAD_MUTEX_INITIALIZER };
+  pthread_t tids[_FS_MAX_THREADS];
+  threads = (threads < count) ? threads : count;
+  threads = (threads < _FS_MAX_THREADS) ? threads : _FS_MAX_THREADS;
+  int started = 0;
+  /* the calling thread is a worker too */
+  while (started < threads - 1 && pthread_create(&tids[started], NULL, _fs_parallel_worker, &job) == 0) {
+    started++;
+  }
+  _fs_parallel_worker(&job);
+  for (int i = 0; i < started; i++) {
+    pthread_join(tids[i], NULL);
+  }
+  pthread_mutex_destroy(&job.lock);
+}
+
+typedef struct {
+  int fd;
+  char* buf;
+  size_t size;
+  size_t* counts;
+} _fs_split_read_t;
+
+_FS_PRIVATE void _fs_split_read_one(void* ctx, int i) {
+  _fs_split_read_t* job = (_fs_split_read_t*)ctx;
+  size_t offset = (size_t)i * _FS_PARALLEL_CHUNK;
+  size_t len = (job->size - offset < _FS_PARALLEL_CHUNK) ? job->size - offset : (size_t)_FS_PARALLEL_CHUNK;
+  if (!_fs_native_pread_all(job->fd, job->buf + offset, len, offset, &job->counts[i])) {
+    job->counts[i] = (size_t)-1;
+  }
+}
+
+/* reads large files as separate ranges on `_fs.read_threads` threads */
+_FS_PRIVATE bool _fs_native_read_split(int fd, void* buf, size_t size, size_t* count) {
+  int threads = _fs.read_threads;
+  if (threads <= 1 || size < _FS_PARALLEL_MIN) {
+    return _fs_native_read_all(fd, buf, size, count);
+  }
+  int chunks = (int)((size + _FS_PARALLEL_CHUNK - 1) / _FS_PARALLEL_CHUNK);
+  size_t* counts = (size_t*)FS_MALLOC(chunks * sizeof(size_t));
+  if (!counts) {
+    return _fs_native_read_all(fd, buf, size, count);
+  }
+  _fs_split_read_t job = { fd, (char*)buf, size, counts };
+  _fs_parallel_for(chunks, threads, _fs_split_read_one, &job);
+  bool ok = true;
+  *count = 0;
+  for (int i = 0; i < chunks; i++) {
+    if (counts[i] == (size_t)-1) {
+      ok = false;
+      break;
+    }
+    *count += counts[i];
+    /* the file was truncated while it was read */
+    if (counts[i] < _FS_PARALLEL_CHUNK) {
+      break;
+    }
+  }
+  FS_FREE(counts);
+  return ok;
+}
+
+_FS_PRIVATE void* _fs_native_read(int fd, size_t* size) {
+  if (fd < 0) {
+    return NULL;
+  }
+  void* buf = NULL;
+  if (_fs_native_size(fd, size)) {
+    buf = FS_MALLOC(*size);
+  }
+  if (buf && !_fs_native_read_split(fd, buf, *size, size)) {
+    FS_FREE(buf);
+    buf = NULL;
+  }
+  close(fd);
+  return buf;
+}
+
+_FS_PRIVATE bool _fs_native_read_into(int fd, void* buf, size_t capacity, size_t* size) {
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = _fs_native_size(fd, size)
+    && (*size <= capacity)
+    && _fs_native_read_all(fd, buf, *size, size);
+  close(fd);
+  return ok;
+}
+
+_FS_PRIVATE int _fs_ctz(unsigned mask) {
+  return __builtin_ctz(mask);
+}
+
+/* returns the first occurrence of `c` in [p, end) or NULL */
+_FS_PRIVATE const char* _fs_find_byte(const char* p, const char* end, char c) {
+#if defined(__AVX2__)
+  const __m256i needle32 = _mm256_set1_epi8(c);
+  for (; end - p >= 32; p += 32) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i*)p);
+    unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle32));
+    if (mask) {
+      return p + _fs_ctz(mask);
+    }
+  }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__)
+  const __m128i needle16 = _mm_set1_epi8(c);
+  for (; end - p >= 16; p += 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+    unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle16));
+    if (mask) {
+      return p + _fs_ctz(mask);
+    }
+  }
+#endif
+  for (; p < end; p++) {
+    if (*p == c) {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+#if !defined(__SSE4_2__) && !defined(__ARM_FEATURE_CRC32)
+static uint32_t _fs_crc32c_table[256];
+static pthread_once_t _fs_crc32c_once = PTHREAD_ONCE_INIT;
+
+_FS_PRIVATE void _fs_crc32c_init(void) {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int j = 0; j < 8; j++) {
+      crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1u)));
+    }
+    _fs_crc32c_table[i] = crc;
+  }
+}
+#endif
+
+/* updates a CRC-32C which starts at, and is finished by xor with, 0xFFFFFFFF */
+_FS_PRIVATE uint32_t _fs_crc32c(uint32_t crc, const void* data, size_t size) {
+  const unsigned char* p = (const unsigned char*)data;
+#if defined(__SSE4_2__) && defined(__x86_64__)
+  uint64_t crc64 = crc;
+  for (; size >= 8; p += 8, size -= 8) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    crc64 = _mm_crc32_u64(crc64, v);
+  }
+  crc = (uint32_t)crc64;
+  for (; size > 0; p++, size--) {
+    crc = _mm_crc32_u8(crc, *p);
+  }
+#elif defined(__SSE4_2__)
+  for (; size >= 4; p += 4, size -= 4) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    crc = _mm_crc32_u32(crc, v);
+  }
+  for (; size > 0; p++, size--) {
+    crc = _mm_crc32_u8(crc, *p);
+  }
+#elif defined(__ARM_FEATURE_CRC32)
+  for (; size >= 8; p += 8, size -= 8) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    crc = __crc32cd(crc, v);
+  }
+  for (; size > 0; p++, size--) {
+    crc = __crc32cb(crc, *p);
+  }
+#else
+  pthread_once(&_fs_crc32c_once, _fs_crc32c_init);
+  for (; size > 0; p++, size--) {
+    crc = (crc >> 8) ^ _fs_crc32c_table[(crc ^ *p) & 0xFF];
+  }
+#endif
+  return crc;
+}
+
+/* like `_fs_native_read_all()` but hashing each chunk while it is in the cache */
+_FS_PRIVATE bool _fs_native_read_hashed(int fd, void* buf, size_t size, size_t* count, uint32_t* hash) {
+  char* p = (char*)buf;
+  uint32_t crc = 0xFFFFFFFFu;
+  *count = 0;
+  while (*count < size) {
+    size_t len = (size - *count < _FS_HASH_CHUNK) ? size - *count : (size_t)_FS_HASH_CHUNK;
+    size_t n;
+    if (!_fs_native_read_all(fd, p + *count, len, &n)) {
+      return false;
+    }
+    crc = _fs_crc32c(crc, p + *count, n);
+    *count += n;
+    if (n < len) {
+      break;
+    }
+  }
+  *hash = crc ^ 0xFFFFFFFFu;
+  return true;
+}
+
+_FS_PRIVATE bool _fs_native_set_direct(int fd, bool enable) {
+#if defined(O_DIRECT)
+  int flags = fcntl(fd, F_GETFL);
+  if (flags < 0) {
+    return false;
+  }
+  flags = enable ? (flags | O_DIRECT) : (flags & ~O_DIRECT);
+  return fcntl(fd, F_SETFL, flags) == 0;
+#elif defined(F_NOCACHE)
+  return fcntl(fd, F_NOCACHE, enable ? 1 : 0) == 0;
+#else
+  (void)fd;
+  return !enable;
+#endif
+}
+
+_FS_PRIVATE void* _fs_native_read_direct(int fd, size_t* size) {
+  if (fd < 0) {
+    return NULL;
+  }
+  void* buf = NULL;
+  size_t len = 0;
+  if (_fs_native_size(fd, &len)) {
+    /* direct transfers must cover whole blocks, even at the end of the file */
+    len = (len + _FS_DIRECT_ALIGN - 1) & ~(size_t)(_FS_DIRECT_ALIGN - 1);
+    buf = _fs_malloc_aligned(len, _FS_DIRECT_ALIGN);
+  }
+  if (buf) {
+    bool ok = _fs_native_set_direct(fd, true) && _fs_native_pread_all(fd, buf, len, 0, size);
+    if (!ok) {
+      /* the filesystem rejected direct I/O, read through the page cache */
+      ok = _fs_native_set_direct(fd, false) && _fs_native_pread_all(fd, buf, len, 0, size);
+    }
+    if (!ok) {
+      _fs_free_aligned(buf);
+      buf = NULL;
+    }
+  }
+  close(fd);
+  return buf;
+}
+
+_FS_PRIVATE void* _fs_native_read_range(int fd, size_t offset, size_t length, size_t* size) {
+  if (fd < 0) {
+    return NULL;
+  }
+  void* buf = NULL;
+  size_t len;
+  if (_fs_native_size(fd, &len) && offset < len) {
+    len = (len - offset < length) ? len - offset : length;
+    buf = FS_MALLOC(len);
+  }
+  if (buf && !_fs_native_pread_all(fd, buf, len, offset, size)) {
+    FS_FREE(buf);
+    buf = NULL;
+  }
+  close(fd);
+  return buf;
+}
+
+_FS_PRIVATE const void* _fs_native_map(int fd, size_t* size) {
+  if (fd < 0) {
+    return NULL;
+  }
+  void* p = MAP_FAILED;
+  size_t len;
+  if (_fs_native_size(fd, &len) && len > 0) {
+    p = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  /* the mapping keeps its own reference to the file */
+  close(fd);
+  if (p == MAP_FAILED) {
+    return NULL;
+  }
+  *size = len;
+  return p;
+}
+
+_FS_PRIVATE void* _fs_native_map_write(const char* filename, size_t size) {
+  /* a file this call created is removed again if it can't be mapped */
+  int fd = open(filename, O_RDWR | O_CREAT | O_EXCL, 0666);
+  bool created = (fd >= 0);
+  if (!created && errno == EEXIST) {
+    fd = _fs_native_open(filename, _FS_MREADWRITE);
+  }
+  if (fd < 0) {
+    return NULL;
+  }
+  void* p = MAP_FAILED;
+  /* blocks are allocated now, so running out of space fails here instead of faulting later */
+  int err = _fs_native_reserve(fd, size);
+  if (err != ENOSPC && err != EDQUOT && ftruncate(fd, (off_t)size) == 0) {
+    p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (p == MAP_FAILED && created) {
+    _fs_native_delete(filename);
+  }
+  return (p == MAP_FAILED) ? NULL : p;
+}
+
+/* copies from `in` at `offset` to the current position of `out`, returns the bytes copied */
+_FS_PRIVATE ssize_t _fs_native_copy_chunk(int in, int out, size_t offset, size_t len, int* method) {
+  ssize_t ret = -1;
+#if defined(__linux__) && defined(__NR_copy_file_range)
+  if (*method == _FS_COPY_RANGE) {
+    long long off = (long long)offset;
+    ret = (ssize_t)syscall(__NR_copy_file_range, in, &off, out, NULL, len, 0);
+    if (ret >= 0 || errno == EINTR) {
+      return ret;
+    }
+    /* e.g. crossing filesystems on older kernels */
+    *method = _FS_COPY_SENDFILE;
+  }
+#endif
+#if defined(__linux__)
+  if (*method <= _FS_COPY_SENDFILE) {
+    off_t off = (off_t)offset;
+    ret = sendfile(out, in, &off, len);
+    if (ret >= 0 || errno == EINTR) {
+      return ret;
+    }
+    *method = _FS_COPY_BUFFER;
+  }
+#endif
+  *method = _FS_COPY_BUFFER;
+  len = (len < _FS_COPY_CHUNK) ? len : (size_t)_FS_COPY_CHUNK;
+  char* buf = (char*)FS_MALLOC(len);
+  if (!buf) {
+    return -1;
+  }
+  size_t count;
+  ret = -1;
+  if (_fs_native_pread_all(in, buf, len, offset, &count) && _fs_native_write_all(out, buf, count)) {
+    ret = (ssize_t)count;
+  }
+  FS_FREE(buf);
+  return ret;
+}
+
+/* shares the data of `in` with `out` on copy-on-write filesystems */
+_FS_PRIVATE bool _fs_native_clone(int in, int out) {
+#if defined(__linux__)
+  return ioctl(out, FICLONE, in) == 0;
+#else
+  return false;
+#endif
+}
+
+/* `out` is opened without truncating it, so copying a file onto itself can be refused */
+_FS_PRIVATE bool _fs_native_copy(int in, int out) {
+  bool ok = (in >= 0 && out >= 0);
+  size_t size = 0, copied = 0;
+  ok = ok && _fs_native_size(in, &size);
+  struct stat in_st, out_st;
+  ok = ok && fstat(in, &in_st) == 0 && fstat(out, &out_st) == 0;
+  ok = ok && (in_st.st_dev != out_st.st_dev || in_st.st_ino != out_st.st_ino);
+  ok = ok && ftruncate(out, 0) == 0;
+  if (ok && size > 0 && _fs_native_clone(in, out)) {
+    copied = size;
+  }
+  int method = _FS_COPY_RANGE;
+  while (ok && copied < size) {
+    ssize_t n = _fs_native_copy_chunk(in, out, copied, size - copied, &method);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      /* zero bytes means the source was truncated while copying */
+      ok = (n == 0);
+      break;
+    }
+    copied += (size_t)n;
+  }
+  if (in >= 0) {
+    close(in);
+  }
+  if (out >= 0 && close(out) != 0) {
+    ok = false;
+  }
+  return ok;
+}
+
+_FS_PRIVATE bool _fs_native_advise(int fd, fs_access access) {
+#if defined(POSIX_FADV_NORMAL)
+  static const int advice[] = {
+    POSIX_FADV_NORMAL,
+    POSIX_FADV_SEQUENTIAL,
+    POSIX_FADV_RANDOM,
+    POSIX_FADV_WILLNEED,
+    POSIX_FADV_DONTNEED,
+  };
+  /* FS_ASSERT may be compiled out, the table must not be read past its end */
+  if ((unsigned)access >= sizeof(advice) / sizeof(advice[0])) {
+    return false;
+  }
+  return posix_fadvise(fd, 0, 0, advice[access]) == 0;
+#else
+  (void)fd;
+  (void)access;
+  return false;
+#endif
+}
+
+_FS_PRIVATE bool _fs_native_advise_map(const void* p, size_t size, fs_access access) {
+#if defined(POSIX_MADV_NORMAL)
+  /* glibc's posix_madvise ignores POSIX_MADV_DONTNEED, it would discard changes otherwise */
+  static const int advice[] = {
+    POSIX_MADV_NORMAL,
+    POSIX_MADV_SEQUENTIAL,
+    POSIX_MADV_RANDOM,
+    POSIX_MADV_WILLNEED,
+    POSIX_MADV_DONTNEED,
+  };
+  if ((unsigned)access >= sizeof(advice) / sizeof(advice[0])) {
+    return false;
+  }
+  return posix_madvise((void*)p, size, advice[access]) == 0;
+#else
+  (void)p;
+  (void)size;
+  (void)access;
+  return false;
+#endif
+}
+
+_FS_PRIVATE bool _fs_native_write(int fd, const fs_data* data) {
+  if (fd < 0) {
+    return false;
+  }
+  /* large files are allocated at once so they are not fragmented */
+  if (data->size >= _FS_PREALLOC_MIN) {
+    _fs_native_reserve(fd, data->size);
+  }
+  bool ok = _fs_native_write_all(fd, data->data, data->size);
+  close(fd);
+  return ok;
+}
+
+_FS_PRIVATE bool _fs_native_writev(int fd, const fs_data* data, int count) {
+  if (fd < 0) {
+    return false;
+  }
+  size_t size = 0;
+  for (int i = 0; i < count; i++) {
+    size += data[i].size;
+  }
+  if (size >= _FS_PREALLOC_MIN) {
+    _fs_native_reserve(fd, size);
+  }
+  bool ok = _fs_native_writev_all(fd, data, count);
+  close(fd);
+  return ok;
+}
+
+typedef struct {
+  const char* const* names;
+  fs_data* results;
+} _fs_read_many_t;
+
+_FS_PRIVATE void _fs_read_many_one(void* ctx, int i) {
+  _fs_read_many_t* job = (_fs_read_many_t*)ctx;
+  size_t size = 0;
+  void* buf = _fs_native_read(_fs_resolve_open(job->names[i]), &size);
+  job->results[i].data = buf;
+  job->results[i].size = buf ? size : 0;
+}
+
+typedef struct {
+  const char* const* names;
+  const fs_data* data;
+  bool* written;
+  bool sync;
+} _fs_write_many_t;
+
+_FS_PRIVATE void _fs_write_many_one(void* ctx, int i) {
+  _fs_write_many_t* job = (_fs_write_many_t*)ctx;
+  char buf[FS_MAX_PATH];
+  int fd = _fs_concat_path(buf, &_fs.write_dir, job->names[i]) ? _fs_native_open(buf, _FS_MWRITE) : -1;
+  bool ok = (fd >= 0) && _fs_native_write_all(fd, job->data[i].data, job->data[i].size);
+  ok = ok && (!job->sync || _fs_native_sync(fd));
+  if (fd >= 0) {
+    close(fd);
+  }
+  job->written[i] = ok;
+}
+
+_FS_PRIVATE void* _fs_pool_worker(void* arg) {
+  _fs_pool_t* pool = (_fs_pool_t*)arg;
+  for (;;) {
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->head && !pool->stop) {
+      pthread_cond_wait(&pool->cond, &pool->lock);
+    }
+    _fs_job_t* job = pool->head;
+    if (job) {
+      pool->head = job->next;
+      pool->tail = (pool->head) ? pool->tail : NULL;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    /* pending jobs are drained before stopping */
+    if (!job) {
+      break;
+    }
+    size_t size = 0;
+    void* data = _fs_native_read(_fs_resolve_open(job->name), &size);
+    job->callback(job->name, data, data ? size : 0, job->userdata);
+    FS_FREE(job);
+  }
+  return NULL;
+}
+
+/* expects the pool lock to be held */
+_FS_PRIVATE bool _fs_pool_start(_fs_pool_t* pool) {
+  while (pool->started < pool->num_threads) {
+    if (pthread_create(&pool->threads[pool->started], NULL, _fs_pool_worker, pool) != 0) {
+      break;
+    }
+    pool->started++;
+  }
+  return pool->started > 0;
+}
+
+_FS_PRIVATE void _fs_pool_stop(_fs_pool_t* pool) {
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = true;
+  pthread_cond_broadcast(&pool->cond);
+  pthread_mutex_unlock(&pool->lock);
+  for (int i = 0; i < pool->started; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+  pool->started = 0;
+  pool->stop = false;
+}
+
+_FS_PRIVATE void* _fs_writer_worker(void* arg) {
+  _fs_writer_t* writer = (_fs_writer_t*)arg;
+  for (;;) {
+    pthread_mutex_lock(&writer->lock);
+    while (!writer->head && !writer->stop) {
+      pthread_cond_wait(&writer->cond, &writer->lock);
+    }
+    _fs_write_job_t* job = writer->head;
+    if (job) {
+      writer->head = job->next;
+      writer->tail = (writer->head) ? writer->tail : NULL;
+    }
+    pthread_mutex_unlock(&writer->lock);
+    /* pending jobs are drained before stopping */
+    if (!job) {
+      break;
+    }
+    /* a single thread writes the jobs in order, so appends keep their order */
+    bool ok = _fs_native_write(_fs_native_open(job->path, job->mode), &job->data);
+    pthread_mutex_lock(&writer->lock);
+    writer->pending -= job->data.size;
+    writer->jobs--;
+    writer->failed = writer->failed || !ok;
+    pthread_cond_broadcast(&writer->done);
+    pthread_mutex_unlock(&writer->lock);
+    FS_FREE(job);
+  }
+  return NULL;
+}
+
+_FS_PRIVATE void _fs_writer_stop(_fs_writer_t* writer) {
+  pthread_mutex_lock(&writer->lock);
+  writer->stop = true;
+  pthread_cond_broadcast(&writer->cond);
+  pthread_mutex_unlock(&writer->lock);
+  if (writer->started) {
+    pthread_join(writer->thread, NULL);
+  }
+  writer->started = false;
+  writer->stop = false;
+  writer->failed = false;
+}
+
+_FS_PRIVATE bool _fs_write_async(const char* name, const fs_data* data, int mode) {
+  if (_fs_strempty(&_fs.write_dir)) {
+    return false;
+  }
+  _fs_write_job_t* job = (_fs_write_job_t*)FS_MALLOC(sizeof(_fs_write_job_t) + data->size);
+  if (!job) {
+    return false;
+  }
+  if (!_fs_concat_path(job->path, &_fs.write_dir, name)) {
+    FS_FREE(job);
+    return false;
+  }
+  job->next = NULL;
+  job->mode = mode;
+  job->data.data = job + 1;
+  job->data.size = data->size;
+  if (data->size > 0) {
+    memcpy(job + 1, data->data, data->size);
+  }
+
+  _fs_writer_t* writer = &_fs.writer;
+  pthread_mutex_lock(&writer->lock);
+  if (!writer->started) {
+    writer->started = (pthread_create(&writer->thread, NULL, _fs_writer_worker, writer) == 0);
+  }
+  bool ok = writer->started;
+  /* blocks while the limit would be exceeded, a larger write is accepted once nothing is pending */
+  while (ok && writer->pending > 0 && writer->pending + data->size > writer->limit) {
+    pthread_cond_wait(&writer->done, &writer->lock);
+  }
+  if (ok) {
+    if (writer->tail) {
+      writer->tail->next = job;
+    } else {
+      writer->head = job;
+    }
+    writer->tail = job;
+    writer->pending += data->size;
+    writer->jobs++;
+    pthread_cond_signal(&writer->cond);
+  }
+  pthread_mutex_unlock(&writer->lock);
+  if (!ok) {
+    FS_FREE(job);
+  }
+  return ok;
+}
+
+_FS_PRIVATE unsigned _fs_cache_hash_path(const char* path) {
+  unsigned hash = 2166136261u;
+  for (; *path; path++) {
+    hash = (hash ^ (unsigned char)*path) * 16777619u;
+  }
+  return hash % _FS_CACHE_BUCKETS;
+}
+
+_FS_PRIVATE unsigned _fs_cache_hash_data(const void* p) {
+  uintptr_t addr = (uintptr_t)p;
+  return (unsigned)((addr >> 4) ^ (addr >> 16)) % _FS_CACHE_BUCKETS;
+}
+
+/* the functions below expect the cache lock to be held */
+_FS_PRIVATE void _fs_cache_unlink(_fs_cache_t* cache, _fs_cache_entry_t* e) {
+  if (e->prev) {
+    e->prev->next = e->next;
+  } else {
+    cache->head = e->next;
+  }
+  if (e->next) {
+    e->next->prev = e->prev;
+  } else {
+    cache->tail = e->prev;
+  }
+  e->prev = e->next = NULL;
+}
+
+_FS_PRIVATE void _fs_cache_push_front(_fs_cache_t* cache, _fs_cache_entry_t* e) {
+  e->prev = NULL;
+  e->next = cache->head;
+  if (cache->head) {
+    cache->head->prev = e;
+  } else {
+    cache->tail = e;
+  }
+  cache->head = e;
+}
+
+_FS_PRIVATE void _fs_cache_destroy(_fs_cache_t* cache, _fs_cache_entry_t* e) {
+  _fs_cache_entry_t** link = &cache->by_data[_fs_cache_hash_data(e->data)];
+  for (; *link; link = &(*link)->data_next) {
+    if (*link == e) {
+      *link = e->data_next;
+      break;
+    }
+  }
+  FS_FREE(e->data);
+  FS_FREE(e);
+}
+
+/* removes an entry from the cache, it is destroyed once it is no longer in use */
+_FS_PRIVATE void _fs_cache_evict(_fs_cache_t* cache, _fs_cache_entry_t* e) {
+  _fs_cache_entry_t** link = &cache->by_path[_fs_cache_hash_path(e->path)];
+  for (; *link; link = &(*link)->path_next) {
+    if (*link == e) {
+      *link = e->path_next;
+      break;
+    }
+  }
+  _fs_cache_unlink(cache, e);
+  cache->total -= e->size;
+  e->cached = false;
+  if (e->refs == 0) {
+    _fs_cache_destroy(cache, e);
+  }
+}
+
+_FS_PRIVATE void* _fs_cache_lookup(_fs_cache_t* cache, const char* path, size_t size, long long modtime) {
+  _fs_cache_entry_t* e = cache->by_path[_fs_cache_hash_path(path)];
+  for (; e; e = e->path_next) {
+    if (strcmp(e->path, path) == 0) {
+      break;
+    }
+  }
+  if (!e) {
+    return NULL;
+  }
+  if (e->size != size || e->modtime != modtime) {
+    _fs_cache_evict(cache, e);
+    return NULL;
+  }
+  e->refs++;
+  _fs_cache_unlink(cache, e);
+  _fs_cache_push_front(cache, e);
+  return e->data;
+}
+
+_FS_PRIVATE bool _fs_cache_insert(_fs_cache_t* cache, const char* path, void* data, size_t size, long long modtime) {
+  if (size > cache->capacity) {
+    return false;
+  }
+  _fs_cache_entry_t* e = (_fs_cache_entry_t*)FS_MALLOC(sizeof(_fs_cache_entry_t));
+  if (!e) {
+    return false;
+  }
+  /* another thread may have cached the same file in the meantime */
+  _fs_cache_entry_t* old = cache->by_path[_fs_cache_hash_path(path)];
+  for (; old; old = old->path_next) {
+    if (strcmp(old->path, path) == 0) {
+      _fs_cache_evict(cache, old);
+      break;
+    }
+  }
+  memset(e, 0, sizeof(_fs_cache_entry_t));
+  strcpy(e->path, path);
+  e->data = data;
+  e->size = size;
+  e->modtime = modtime;
+  e->refs = 1;
+  e->cached = true;
+  unsigned h = _fs_cache_hash_path(path);
+  e->path_next = cache->by_path[h];
+  cache->by_path[h] = e;
+  h = _fs_cache_hash_data(data);
+  e->data_next = cache->by_data[h];
+  cache->by_data[h] = e;
+  _fs_cache_push_front(cache, e);
+  cache->total += size;
+  while (cache->total > cache->capacity && cache->tail != e) {
+    _fs_cache_evict(cache, cache->tail);
+  }
+  return true;
+}
+
+/* returns false if `p` was not handed out by the cache */
+_FS_PRIVATE bool _fs_cache_release(_fs_cache_t* cache, void* p) {
+  _fs_cache_entry_t* e = cache->by_data[_fs_cache_hash_data(p)];
+  for (; e; e = e->data_next) {
+    if (e->data == p) {
+      break;
+    }
+  }
+  if (!e) {
+    return false;
+  }
+  if (--e->refs == 0 && !e->cached) {
+    _fs_cache_destroy(cache, e);
+  }
+  return true;
+}
+
+/* memory still in use is handed over to the user, to be freed by `fs_free()` */
+_FS_PRIVATE void _fs_cache_clear(_fs_cache_t* cache) {
+  for (int i = 0; i < _FS_CACHE_BUCKETS; i++) {
+    _fs_cache_entry_t* e = cache->by_data[i];
+    while (e) {
+      _fs_cache_entry_t* next = e->data_next;
+      if (e->refs == 0) {
+        FS_FREE(e->data);
+      }
+      FS_FREE(e);
+      e = next;
+    }
+  }
+  memset(cache->by_path, 0, sizeof(cache->by_path));
+  memset(cache->by_data, 0, sizeof(cache->by_data));
+  cache->head = cache->tail = NULL;
+  cache->total = 0;
+}
+
+_FS_PRIVATE void* _fs_cache_read(const char* name, size_t* size) {
+  _fs_cache_t* cache = &_fs.cache;
+  char path[FS_MAX_PATH];
+  size_t len = 0;
+  long long modtime = 0;
+  /* resolved like an uncached read, and validated against the file which was opened */
+  int fd = _fs_resolve_open_path(name, path);
+  if (fd < 0) {
+    return NULL;
+  }
+  if (!_fs_native_stat(fd, &len, &modtime)) {
+    close(fd);
+    return NULL;
+  }
+  pthread_mutex_lock(&cache->lock);
+  void* data = _fs_cache_lookup(cache, path, len, modtime);
+  pthread_mutex_unlock(&cache->lock);
+  if (data) {
+    close(fd);
+    *size = len;
+    return data;
+  }
+  data = _fs_native_read(fd, size);
+  /* only cache what matches the size and time it was validated against */
+  if (data && *size == len) {
+    pthread_mutex_lock(&cache->lock);
+    _fs_cache_insert(cache, path, data, len, modtime);
+    pthread_mutex_unlock(&cache->lock);
+  }
+  return data;
+}
+
+#if defined(_FS_IO_URING)
+
+typedef struct {
+  int fd;
+  unsigned entries;
+  unsigned tail;
+  unsigned *sq_tail, *sq_mask, *sq_array;
+  unsigned *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_sqe* sqes;
+  struct io_uring_cqe* cqes;
+  void* sq_ptr;
+  void* cq_ptr;
+  size_t sq_size, cq_size, sqes_size;
+  bool busy;    /* requests may still be in flight, their memory must not be freed */
+} _fs_uring;
+
+_FS_PRIVATE void _fs_uring_free(_fs_uring* ring) {
+  if (ring->busy) {
+    return;
+  }
+  if (ring->sqes) {
+    munmap(ring->sqes, ring->sqes_size);
+  }
+  if (ring->cq_ptr && ring->cq_ptr != ring->sq_ptr) {
+    munmap(ring->cq_ptr, ring->cq_size);
+  }
+  if (ring->sq_ptr) {
+    munmap(ring->sq_ptr, ring->sq_size);
+  }
+  close(ring->fd);
+}
+
+_FS_PRIVATE bool _fs_uring_init(_fs_uring* ring, unsigned entries) {
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+  if (ring->fd < 0) {
+    return false;
+  }
+  /* openat and read opcodes arrived in the same kernel as this feature */
+  if (!(p.features & IORING_FEAT_RW_CUR_POS)) {
+    close(ring->fd);
+    return false;
+  }
+  ring->entries = p.sq_entries;
+  ring->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  ring->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->sq_size = (ring->sq_size > ring->cq_size) ? ring->sq_size : ring->cq_size;
+    ring->cq_size = ring->sq_size;
+  }
+  ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sq_ptr == MAP_FAILED) {
+    ring->sq_ptr = NULL;
+    _fs_uring_free(ring);
+    return false;
+  }
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->cq_ptr = ring->sq_ptr;
+  } else {
+    ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ptr == MAP_FAILED) {
+      ring->cq_ptr = NULL;
+      _fs_uring_free(ring);
+      return false;
+    }
+  }
+  ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED) {
+    ring->sqes = NULL;
+    _fs_uring_free(ring);
+    return false;
+  }
+  char* sq = (char*)ring->sq_ptr;
+  char* cq = (char*)ring->cq_ptr;
+  ring->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+  ring->sq_mask = (unsigned*)(sq + p.sq_off.ring_mask);
+  ring->sq_array = (unsigned*)(sq + p.sq_off.array);
+  ring->cq_head = (unsigned*)(cq + p.cq_off.head);
+  ring->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+  ring->cq_mask = (unsigned*)(cq + p.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+  ring->tail = *ring->sq_tail;
+  return true;
+}
+
+_FS_PRIVATE struct io_uring_sqe* _fs_uring_sqe(_fs_uring* ring, unsigned long long user_data) {
+  unsigned idx = ring->tail++ & *ring->sq_mask;
+  struct io_uring_sqe* sqe = &ring->sqes[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->user_data = user_data;
+  ring->sq_array[idx] = idx;
+  return sqe;
+}
+
+/* submits the prepared entries and calls `done` for each of their `count` completions */
+_FS_PRIVATE bool _fs_uring_submit(_fs_uring* ring, unsigned count, void (*done)(void*, int, int), void* ctx) {
+  __atomic_store_n(ring->sq_tail, ring->tail, __ATOMIC_RELEASE);
+  unsigned submit = count;
+  bool failed = false;
+  while (count > (failed ? submit : 0)) {
+    int ret = (int)syscall(__NR_io_uring_enter, ring->fd, failed ? 0 : submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    if (ret < 0 && errno != EINTR) {
+      if (failed) {
+        ring->busy = true;
+        return false;
+      }
+      /* entries the kernel already took are waited for before giving up */
+      failed = true;
+      continue;
+    }
+    if (ret > 0 && !failed) {
+      submit -= ((unsigned)ret < submit) ? (unsigned)ret : submit;
+    }
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail && count > 0; head++, count--) {
+      struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+      done(ctx, (int)cqe->user_data, cqe->res);
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+  }
+  return !failed;
+}
+
+enum {
+  _FS_BATCH_OPEN,
+  _FS_BATCH_IO,
+  _FS_BATCH_SYNC,
+  _FS_BATCH_DONE,
+  _FS_BATCH_FAIL,
+};
+
+typedef struct {
+  char path[FS_MAX_PATH];
+  int state;
+  int dir;
+  int fd;
+  char* buf;
+  size_t size;
+  size_t done;
+} _fs_batch_op;
+
+typedef struct {
+  const char* const* names;
+  _fs_batch_op* ops;
+  int opened;
+  int closed;
+  int round_closed;
+} _fs_uring_read_t;
+
+/* a finished file gives its descriptor back right away, batches may be larger than the fd limit */
+_FS_PRIVATE void _fs_batch_finish(_fs_batch_op* op, int state, int* closed) {
+  op->state = state;
+  if (op->fd >= 0) {
+    close(op->fd);
+    op->fd = -1;
+    (*closed)++;
+  }
+}
+
+_FS_PRIVATE void _fs_uring_read_done(void* ctx, int i, int res) {
+  _fs_uring_read_t* job = (_fs_uring_read_t*)ctx;
+  _fs_batch_op* op = &job->ops[i];
+  if (op->state == _FS_BATCH_OPEN) {
+    if (res < 0 && _fs_resolve_next(-res)) {
+      /* try the next entry in the search path */
+      op->dir--;
+      return;
+    }
+    /* out of descriptors, it is opened again when this round closed or will close some of them */
+    if (res == -EINTR || res == -EAGAIN || ((res == -EMFILE || res == -ENFILE) && job->opened > job->round_closed)) {
+      return;
+    }
+    if (res < 0) {
+      op->state = _FS_BATCH_FAIL;
+      return;
+    }
+    op->fd = res;
+    job->opened++;
+    int state = _FS_BATCH_FAIL;
+    if (_fs_native_size(op->fd, &op->size)) {
+      op->buf = (char*)FS_MALLOC(op->size);
+      if (op->buf) {
+        state = (op->size > 0) ? _FS_BATCH_IO : _FS_BATCH_DONE;
+      }
+    }
+    if (state == _FS_BATCH_IO) {
+      op->state = state;
+    } else {
+      _fs_batch_finish(op, state, &job->closed);
+    }
+  } else if (op->state == _FS_BATCH_IO) {
+    if (res == -EINTR || res == -EAGAIN) {
+      return;
+    }
+    if (res < 0) {
+      _fs_batch_finish(op, _FS_BATCH_FAIL, &job->closed);
+      return;
+    }
+    op->done += (size_t)res;
+    if (res == 0 || op->done == op->size) {
+      op->size = op->done;
+      _fs_batch_finish(op, _FS_BATCH_DONE, &job->closed);
+    }
+  }
+}
+
+_FS_PRIVATE bool _fs_uring_read_many(const char* const* names, fs_data* results, int count) {
+  _fs_uring ring;
+  if (!_fs_uring_init(&ring, _FS_URING_ENTRIES)) {
+    return false;
+  }
+  _fs_batch_op* ops = (_fs_batch_op*)FS_MALLOC(count * sizeof(_fs_batch_op));
+  if (!ops) {
+    _fs_uring_free(&ring);
+    return false;
+  }
+  for (int i = 0; i < count; i++) {
+    ops[i].state = _FS_BATCH_OPEN;
+    ops[i].fd = -1;
+    ops[i].buf = NULL;
+    ops[i].size = ops[i].done = 0;
+  }
+  _fs_search_t search;
+  _fs_search_path(&search);
+  for (int i = 0; i < count; i++) {
+    ops[i].dir = search.count - 1;
+  }
+  _fs_uring_read_t ctx = { names, ops, 0, 0, 0 };
+  bool ok = true;
+  for (;;) {
+    unsigned pending = 0;
+    for (int i = 0; i < count && pending < ring.entries; i++) {
+      _fs_batch_op* op = &ops[i];
+      if (op->state == _FS_BATCH_OPEN) {
+        while (op->dir >= 0 && !_fs_concat_path(op->path, &search.base_path[op->dir], names[i])) {
+          op->dir--;
+        }
+        if (op->dir < 0) {
+          op->state = _FS_BATCH_FAIL;
+          continue;
+        }
+        struct io_uring_sqe* sqe = _fs_uring_sqe(&ring, i);
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (unsigned long long)(uintptr_t)op->path;
+        sqe->open_flags = O_RDONLY;
+      } else if (op->state == _FS_BATCH_IO) {
+        size_t len = op->size - op->done;
+        struct io_uring_sqe* sqe = _fs_uring_sqe(&ring, i);
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = op->fd;
+        sqe->addr = (unsigned long long)(uintptr_t)(op->buf + op->done);
+        sqe->len = (len < (1u << 30)) ? (unsigned)len : (1u << 30);
+        sqe->off = op->done;
+      } else {
+        continue;
+      }
+      pending++;
+    }
+    if (pending == 0) {
+      break;
+    }
+    ctx.round_closed = ctx.closed;
+    if (!_fs_uring_submit(&ring, pending, _fs_uring_read_done, &ctx)) {
+      ok = false;
+      break;
+    }
+  }
+  /* the kernel may still write into the buffers, leaking them is the only safe option */
+  if (ring.busy) {
+    return false;
+  }
+  for (int i = 0; i < count; i++) {
+    _fs_batch_op* op = &ops[i];
+    if (op->fd >= 0) {
+      close(op->fd);
+    }
+    if (ok && op->state == _FS_BATCH_DONE) {
+      results[i].data = op->buf;
+      results[i].size = op->size;
+    } else {
+      FS_FREE(op->buf);
+    }
+  }
+  FS_FREE(ops);
+  _fs_uring_free(&ring);
+  return ok;
+}
+
+typedef struct {
+  _fs_batch_op* ops;
+  bool sync;
+  int opened;
+  int closed;
+  int round_closed;
+} _fs_uring_write_t;
+
+/* completions of a file's fsync have odd user data, linked after its write */
+_FS_PRIVATE void _fs_uring_write_done(void* ctx, int ud, int res) {
+  _fs_uring_write_t* job = (_fs_uring_write_t*)ctx;
+  _fs_batch_op* op = &job->ops[ud >> 1];
+  if (ud & 1) {
+    /* canceled when the write before it was short, it is submitted again */
+    if (res == -ECANCELED || res == -EINTR) {
+      return;
+    }
+    _fs_batch_finish(op, (res < 0) ? _FS_BATCH_FAIL : _FS_BATCH_DONE, &job->closed);
+  } else if (op->state == _FS_BATCH_OPEN) {
+    /* out of descriptors, it is opened again when this round closed or will close some of them */
+    if (res == -EINTR || res == -EAGAIN || ((res == -EMFILE || res == -ENFILE) && job->opened > job->round_closed)) {
+      return;
+    }
+    if (res < 0) {
+      op->state = _FS_BATCH_FAIL;
+      return;
+    }
+    op->fd = res;
+    job->opened++;
+    if (op->size > 0) {
+      op->state = _FS_BATCH_IO;
+    } else if (job->sync) {
+      op->state = _FS_BATCH_SYNC;
+    } else {
+      _fs_batch_finish(op, _FS_BATCH_DONE, &job->closed);
+    }
+  } else if (op->state == _FS_BATCH_IO) {
+    if (res == -EINTR || res == -EAGAIN) {
+      return;
+    }
+    if (res <= 0) {
+      /* a linked fsync is canceled and never uses the descriptor */
+      _fs_batch_finish(op, _FS_BATCH_FAIL, &job->closed);
+      return;
+    }
+    op->done += (size_t)res;
+    /* the completion of a linked fsync always comes after the write */
+    if (op->done < op->size) {
+      return;
+    }
+    if (job->sync) {
+      op->state = _FS_BATCH_SYNC;
+    } else {
+      _fs_batch_finish(op, _FS_BATCH_DONE, &job->closed);
+    }
+  }
+}
+
+_FS_PRIVATE bool _fs_uring_write_many(const char* const* names, const fs_data* data, bool* written, int count, bool sync) {
+  _fs_uring ring;
+  if (!_fs_uring_init(&ring, _FS_URING_ENTRIES)) {
+    return false;
+  }
+  _fs_batch_op* ops = (_fs_batch_op*)FS_MALLOC(count * sizeof(_fs_batch_op));
+  if (!ops) {
+    _fs_uring_free(&ring);
+    return false;
+  }
+  for (int i = 0; i < count; i++) {
+    ops[i].state = _fs_concat_path(ops[i].path, &_fs.write_dir, names[i]) ? _FS_BATCH_OPEN : _FS_BATCH_FAIL;
+    ops[i].fd = -1;
+    ops[i].buf = (char*)data[i].data;
+    ops[i].size = data[i].size;
+    ops[i].done = 0;
+  }
+  _fs_uring_write_t ctx = { ops, sync, 0, 0, 0 };
+  bool ok = true;
+  for (;;) {
+    unsigned pending = 0;
+    /* a write may need a second entry for its fsync */
+    for (int i = 0; i < count && pending + 1 < ring.entries; i++) {
+      _fs_batch_op* op = &ops[i];
+      if (op->state == _FS_BATCH_OPEN) {
+        struct io_uring_sqe* sqe = _fs_uring_sqe(&ring, (unsigned long long)i << 1);
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (unsigned long long)(uintptr_t)op->path;
+        sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+        sqe->len = 0666;
+      } else if (op->state == _FS_BATCH_IO) {
+        size_t len = op->size - op->done;
+        struct io_uring_sqe* sqe = _fs_uring_sqe(&ring, (unsigned long long)i << 1);
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = op->fd;
+        sqe->addr = (unsigned long long)(uintptr_t)(op->buf + op->done);
+        sqe->len = (len < (1u << 30)) ? (unsigned)len : (1u << 30);
+        sqe->off = op->done;
+        if (sync && sqe->len == len) {
+          sqe->flags |= IOSQE_IO_LINK;
+          sqe = _fs_uring_sqe(&ring, ((unsigned long long)i << 1) | 1);
+          sqe->opcode = IORING_OP_FSYNC;
+          sqe->fd = op->fd;
+          sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+          pending++;
+        }
+      } else if (op->state == _FS_BATCH_SYNC) {
+        struct io_uring_sqe* sqe = _fs_uring_sqe(&ring, ((unsigned long long)i << 1) | 1);
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = op->fd;
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+      } else {
+        continue;
+      }
+      pending++;
+    }
+    if (pending == 0) {
+      break;
+    }
+    ctx.round_closed = ctx.closed;
+    if (!_fs_uring_submit(&ring, pending, _fs_uring_write_done, &ctx)) {
+      ok = false;
+      break;
+    }
+  }
+  if (ring.busy) {
+    return false;
+  }
+  for (int i = 0; i < count; i++) {
+    if (ops[i].fd >= 0) {
+      close(ops[i].fd);
+    }
+    written[i] = ok && ops[i].state == _FS_BATCH_DONE;
+  }
+  FS_FREE(ops);
+  _fs_uring_free(&ring);
+  return ok;
+}
+
+#endif /* _FS_IO_URING */
+
+/* public api functions */
+
+void fs_setup(const fs_desc* desc) {
+  FS_ASSERT(desc);
+  pthread_mutex_init(&_fs.lock, NULL);
+  pthread_mutex_init(&_fs.pool.lock, NULL);
+  pthread_cond_init(&_fs.pool.cond, NULL);
+  pthread_mutex_init(&_fs.writer.lock, NULL);
+  pthread_cond_init(&_fs.writer.cond, NULL);
+  pthread_cond_init(&_fs.writer.done, NULL);
+  _fs.writer.limit = _fs_def(desc->write_limit, (size_t)_FS_DEFAULT_WRITE_LIMIT);
+  pthread_mutex_init(&_fs.cache.lock, NULL);
+  _fs.cache.capacity = desc->cache_size;
+  int num_threads = _fs_def(desc->num_threads, _FS_DEFAULT_THREADS);
+  _fs.pool.num_threads = (num_threads < _FS_MAX_THREADS) ? num_threads : _FS_MAX_THREADS;
+  int read_threads = _fs_def(desc->read_threads, 1);
+  _fs.read_threads = (read_threads < _FS_MAX_THREADS) ? read_threads : _FS_MAX_THREADS;
+  _fs_strcpy(&_fs.write_dir, desc->write_dir);
+  for (int i = 0; i < FS_MAX_MOUNTS; i++) {
+    if (desc->base_paths[i]) {
+      _fs_strcpy(&_fs.base_path[i], desc->base_paths[i]);
+      _fs.count++;  
+    }
+  }
+  /* always last */
+  _fs.valid = true;
+}
+
+void fs_shutdown(void) {
+  FS_ASSERT(_fs.valid);
+  _fs_pool_stop(&_fs.pool);
+  pthread_cond_destroy(&_fs.pool.cond);
+  pthread_mutex_destroy(&_fs.pool.lock);
+  _fs_writer_stop(&_fs.writer);
+  pthread_cond_destroy(&_fs.writer.done);
+  pthread_cond_destroy(&_fs.writer.cond);
+  pthread_mutex_destroy(&_fs.writer.lock);
+  _fs_cache_clear(&_fs.cache);
+  _fs.cache.capacity = 0;
+  pthread_mutex_destroy(&_fs.cache.lock);
+  pthread_mutex_destroy(&_fs.lock);
+  _fs.valid = false;
+}
+
+bool fs_is_valid(void) {
+  return _fs.valid;
+}
+
+bool fs_insert_basepath(const char* path) {
+  FS_ASSERT(path);
+  if (strlen(path) >= FS_MAX_PATH) {
+    return false;
+  }
+  pthread_mutex_lock(&_fs.lock);
+  bool inserted = (_fs.count < FS_MAX_MOUNTS);
+  _fs_path* dir = &_fs.base_path[_fs.count - 1];
+  for (; inserted && dir >= _fs.base_path; dir--) {
+    if (strcmp(dir->buf, path) == 0) {
+      inserted = false;
+    }
+  }
+  if (inserted) {
+    dir = &_fs.base_path[_fs.count++];
+    strcpy(dir->buf, path);
+  }
+  pthread_mutex_unlock(&_fs.lock);
+  return inserted;
+}
+
+bool fs_remove_basepath(const char* path) {
+  FS_ASSERT(path);
+  pthread_mutex_lock(&_fs.lock);
+  bool removed = false;
+  _fs_path* dir = &_fs.base_path[_fs.count - 1];
+  for (; dir >= _fs.base_path; dir--) {
+    if (strcmp(dir->buf, path) == 0) {
+      int idx = dir - _fs.base_path;
+      memmove(dir, dir + 1, (_fs.count - idx - 1) * sizeof(_fs_path));
+      memset(&_fs.base_path[_fs.count - 1].buf, 0, FS_MAX_PATH);
+      _fs.count--;
+      removed = true;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&_fs.lock);
+  return removed;
+}
+
+bool fs_exists(const char* filename) {
+  FS_ASSERT(filename);
+  char buf[FS_MAX_PATH];
+  _fs_search_t search;
+  _fs_search_path(&search);
+  _fs_path* dir = &search.base_path[search.count - 1];
+  for (; dir >= search.base_path; dir--) {
+    if (_fs_concat_path(buf, dir, filename) && _fs_get_file_info(buf, NULL)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void* fs_read(const char* name, size_t* size) {
+  FS_ASSERT(name && size);
+  if (_fs.cache.capacity > 0) {
+    return _fs_cache_read(name, size);
+  }
+  return _fs_native_read(_fs_resolve_open(name), size);
+}
+
+void* fs_read_direct(const char* name, size_t* size) {
+  FS_ASSERT(name && size);
+  return _fs_native_read_direct(_fs_resolve_open(name), size);
+}
+
+void* fs_read_hashed(const char* name, size_t* size, uint32_t* hash) {
+  FS_ASSERT(name && size && hash);
+  int fd = _fs_resolve_open(name);
+  if (fd < 0) {
+    return NULL;
+  }
+  void* buf = NULL;
+  if (_fs_native_size(fd, size)) {
+    buf = FS_MALLOC(*size);
+  }
+  if (buf && !_fs_native_read_hashed(fd, buf, *size, size, hash)) {
+    FS_FREE(buf);
+    buf = NULL;
+  }
+  close(fd);
+  return buf;
+}
+
+bool fs_hash(const char* name, uint32_t* hash) {
+  FS_ASSERT(name && hash);
+  int fd = _fs_resolve_open(name);
+  size_t size;
+  if (fd < 0 || !_fs_native_size(fd, &size)) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    return false;
+  }
+  char* chunk = (char*)FS_MALLOC(_FS_HASH_CHUNK);
+  bool ok = (chunk != NULL);
+  uint32_t crc = 0xFFFFFFFFu;
+  size_t n = 0;
+  while (ok && (ok = _fs_native_read_all(fd, chunk, _FS_HASH_CHUNK, &n)) && n > 0) {
+    crc = _fs_crc32c(crc, chunk, n);
+  }
+  *hash = crc ^ 0xFFFFFFFFu;
+  FS_FREE(chunk);
+  close(fd);
+  return ok;
+}
 
-bool fs_insert_basepath(const char* path) {
-  FS_ASSERT(path);
-  if (strlen(path) >= FS_MAX_PATH || _fs.count >= FS_MAX_MOUNTS) {
+bool fs_read_into(const char* name, void* buf, size_t capacity, size_t* size) {
+  FS_ASSERT(name && buf && size);
+  return _fs_native_read_into(_fs_resolve_open(name), buf, capacity, size);
+}
+
+void* fs_read_range(const char* name, size_t offset, size_t length, size_t* size) {
+  FS_ASSERT(name && size);
+  return _fs_native_read_range(_fs_resolve_open(name), offset, length, size);
+}
+
+int fs_read_many(const char* const* names, fs_data* results, int count) {
+  FS_ASSERT(names && results && count >= 0);
+  for (int i = 0; i < count; i++) {
+    results[i].data = NULL;
+    results[i].size = 0;
+  }
+  bool done = false;
+#if defined(_FS_IO_URING)
+  done = (count > 0) && _fs_uring_read_many(names, results, count);
+#endif
+  if (!done) {
+    _fs_read_many_t job = { names, results };
+    _fs_parallel_for(count, _FS_MAX_THREADS, _fs_read_many_one, &job);
+  }
+  int read = 0;
+  for (int i = 0; i < count; i++) {
+    read += (results[i].data != NULL);
+  }
+  return read;
+}
+
+int fs_write_many(const char* const* names, const fs_data* data, int count, bool sync) {
+  FS_ASSERT(names && data && count >= 0);
+  if (_fs_strempty(&_fs.write_dir) || count == 0) {
+    return 0;
+  }
+  bool* written = (bool*)FS_MALLOC(count * sizeof(bool));
+  if (!written) {
+    return 0;
+  }
+  bool done = false;
+#if defined(_FS_IO_URING)
+  done = _fs_uring_write_many(names, data, written, count, sync);
+#endif
+  if (!done) {
+    _fs_write_many_t job = { names, data, written, sync };
+    _fs_parallel_for(count, _FS_MAX_THREADS, _fs_write_many_one, &job);
+  }
+  int total = 0;
+  for (int i = 0; i < count; i++) {
+    total += written[i];
+  }
+  FS_FREE(written);
+  return total;
+}
+
+bool fs_read_async(const char* name, fs_read_callback callback, void* userdata) {
+  FS_ASSERT(name && callback);
+  if (strlen(name) >= FS_MAX_PATH) {
     return false;
   }
-  _fs_path* dir = &_fs.base_path[_fs.count - 1];
-  for (; dir >= _fs.base_path; dir--) {
-    if (strcmp(dir->buf, path) == 0) {
-      return false;
+  _fs_job_t* job = (_fs_job_t*)FS_MALLOC(sizeof(_fs_job_t));
+  if (!job) {
+    return false;
+  }
+  strcpy(job->name, name);
+  job->callback = callback;
+  job->userdata = userdata;
+  job->next = NULL;
+
+  _fs_pool_t* pool = &_fs.pool;
+  pthread_mutex_lock(&pool->lock);
+  bool ok = _fs_pool_start(pool);
+  if (ok) {
+    if (pool->tail) {
+      pool->tail->next = job;
+    } else {
+      pool->head = job;
     }
+    pool->tail = job;
+    pthread_cond_signal(&pool->cond);
   }
-  dir = &_fs.base_path[_fs.count++];
-  strcpy(dir->buf, path);
-  return true;
+  pthread_mutex_unlock(&pool->lock);
+  if (!ok) {
+    FS_FREE(job);
+  }
+  return ok;
 }
 
-bool fs_remove_basepath(const char* path) {
-  FS_ASSERT(path);
-  _fs_path* dir = &_fs.base_path[_fs.count - 1];
-  for (; dir >= _fs.base_path; dir--) {
-    if (strcmp(dir->buf, path) == 0) {
-      int idx = dir - _fs.base_path;
-      memmove(dir, dir + 1, (_fs.count - idx - 1) * sizeof(_fs_path));
-      memset(&_fs.base_path[_fs.count - 1].buf, 0, FS_MAX_PATH);
-      _fs.count--;
-      return true;
+bool fs_readv(const char* name, size_t offset, const fs_buffer* buffers, int count, size_t* size) {
+  FS_ASSERT(name && buffers && size && count >= 0);
+  int fd = _fs_resolve_open(name);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = _fs_native_preadv_all(fd, buffers, count, offset, size);
+  close(fd);
+  return ok;
+}
+
+fs_file* fs_open(const char* name) {
+  FS_ASSERT(name);
+  int fd = _fs_resolve_open(name);
+  size_t size;
+  if (fd < 0 || !_fs_native_size(fd, &size)) {
+    if (fd >= 0) {
+      close(fd);
     }
+    return NULL;
   }
-  return false;
+  fs_file* file = (fs_file*)FS_MALLOC(sizeof(fs_file));
+  if (!file) {
+    close(fd);
+    return NULL;
+  }
+  file->fd = fd;
+  file->error = false;
+  return file;
 }
 
-bool fs_exists(const char* filename) {
-  FS_ASSERT(filename);
-  char buf[FS_MAX_PATH];
-  _fs_path* dir = &_fs.base_path[_fs.count - 1];
-  for (; dir >= _fs.base_path; dir--) {
-    if (_fs_concat_path(buf, dir, filename) && _fs_get_file_info(buf, NULL)) {
+size_t fs_read_chunk(fs_file* file, void* buf, size_t size) {
+  FS_ASSERT(file && buf);
+  size_t count;
+  /* bytes read before the error are still returned */
+  if (!_fs_native_read_all(file->fd, buf, size, &count)) {
+    file->error = true;
+  }
+  return count;
+}
+
+bool fs_file_error(const fs_file* file) {
+  FS_ASSERT(file);
+  return file->error;
+}
+
+void fs_close(fs_file* file) {
+  if (file != NULL) {
+    close(file->fd);
+    FS_FREE(file);
+  }
+}
+
+fs_records* fs_records_open(const char* name, char delim) {
+  FS_ASSERT(name);
+  fs_records* records = (fs_records*)FS_MALLOC(sizeof(fs_records));
+  if (!records) {
+    return NULL;
+  }
+  memset(records, 0, sizeof(fs_records));
+  records->delim = delim;
+  records->capacity = _FS_RECORDS_CHUNK;
+  records->buf = (char*)FS_MALLOC(records->capacity);
+  records->fd = _fs_resolve_open(name);
+  size_t size;
+  if (!records->buf || records->fd < 0 || !_fs_native_size(records->fd, &size)) {
+    fs_records_close(records);
+    return NULL;
+  }
+  return records;
+}
+
+fs_records* fs_lines_open(const char* name) {
+  return fs_records_open(name, '\n');
+}
+
+bool fs_records_next(fs_records* records, fs_data* record) {
+  FS_ASSERT(records && record);
+  while (!records->error) {
+    const char* found = _fs_find_byte(records->buf + records->scan, records->buf + records->end, records->delim);
+    if (found) {
+      size_t pos = (size_t)(found - records->buf);
+      record->data = records->buf + records->start;
+      record->size = pos - records->start;
+      records->start = records->scan = pos + 1;
+      return true;
+    }
+    records->scan = records->end;
+    if (records->eof) {
+      /* the last record may not end with a delimiter */
+      if (records->start == records->end) {
+        return false;
+      }
+      record->data = records->buf + records->start;
+      record->size = records->end - records->start;
+      records->start = records->end;
       return true;
     }
+    /* make room for the next chunk, keeping the partial record */
+    size_t partial = records->end - records->start;
+    memmove(records->buf, records->buf + records->start, partial);
+    records->start = 0;
+    records->scan = records->end = partial;
+    if (records->capacity - partial < _FS_RECORDS_CHUNK) {
+      size_t capacity = records->capacity * 2;
+      char* buf = (char*)FS_MALLOC(capacity);
+      if (!buf) {
+        records->error = true;
+        return false;
+      }
+      memcpy(buf, records->buf, partial);
+      FS_FREE(records->buf);
+      records->buf = buf;
+      records->capacity = capacity;
+    }
+    size_t count;
+    if (!_fs_native_read_all(records->fd, records->buf + records->end, records->capacity - records->end, &count)) {
+      records->error = true;
+      return false;
+    }
+    records->end += count;
+    records->eof = (count == 0);
   }
   return false;
 }
 
-void* fs_read(const char* name, size_t* size) {
+bool fs_records_error(const fs_records* records) {
+  FS_ASSERT(records);
+  return records->error;
+}
+
+void fs_records_close(fs_records* records) {
+  if (records != NULL) {
+    if (records->fd >= 0) {
+      close(records->fd);
+    }
+    FS_FREE(records->buf);
+    FS_FREE(records);
+  }
+}
+
+bool fs_prefetch(const char* name) {
+  FS_ASSERT(name);
+  int fd = _fs_resolve_open(name);
+  if (fd < 0) {
+    return false;
+  }
+  /* the page cache keeps the pages once the file is closed */
+  bool ok = _fs_native_advise(fd, FS_ACCESS_WILLNEED);
+  close(fd);
+  return ok;
+}
+
+bool fs_advise(fs_file* file, fs_access access) {
+  FS_ASSERT(file && access >= FS_ACCESS_NORMAL && access <= FS_ACCESS_DONTNEED);
+  return _fs_native_advise(file->fd, access);
+}
+
+bool fs_advise_map(const void* p, size_t size, fs_access access) {
+  FS_ASSERT(p && access >= FS_ACCESS_NORMAL && access <= FS_ACCESS_DONTNEED);
+  return _fs_native_advise_map(p, size, access);
+}
+
+const void* fs_map(const char* name, size_t* size) {
   FS_ASSERT(name && size);
+  return _fs_native_map(_fs_resolve_open(name), size);
+}
+
+void fs_unmap(const void* p, size_t size) {
+  if (p != NULL) {
+    munmap((void*)p, size);
+  }
+}
+
+bool fs_write_range(const char* name, size_t offset, const fs_data* data) {
+  FS_ASSERT(name && data);
+  if (_fs_strempty(&_fs.write_dir)) {
+    return false;
+  }
   char buf[FS_MAX_PATH];
-  _fs_path* dir = &_fs.base_path[_fs.count - 1];
-  for (; dir >= _fs.base_path; dir--) {
-    if (!_fs_concat_path(buf, dir, name)) {
-      continue;
-    }
-    FILE* fp = _fs_native_open(buf, _FS_MREAD);
-    return _fs_native_read(fp, size);
+  if (!_fs_concat_path(buf, &_fs.write_dir, name)) {
+    return false;
   }
-  return NULL;
+  int fd = _fs_native_open(buf, _FS_MUPDATE);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = _fs_native_pwrite_all(fd, data->data, data->size, offset);
+  close(fd);
+  return ok;
+}
+
+void* fs_map_write(const char* name, size_t size) {
+  FS_ASSERT(name);
+  if (_fs_strempty(&_fs.write_dir) || size == 0) {
+    return NULL;
+  }
+  char buf[FS_MAX_PATH];
+  if (!_fs_concat_path(buf, &_fs.write_dir, name)) {
+    return NULL;
+  }
+  return _fs_native_map_write(buf, size);
+}
+
+bool fs_map_commit(void* p, size_t size) {
+  if (p == NULL) {
+    return false;
+  }
+  bool ok = (msync(p, size, MS_SYNC) == 0);
+  ok = (munmap(p, size) == 0) && ok;
+  return ok;
 }
 
 bool fs_write(const char* name, const fs_data* data) {
@@ -510,8 +3292,21 @@ bool fs_write(const char* name, const fs_data* data) {
   if (!_fs_concat_path(buf, &_fs.write_dir, name)) {
     return false;
   }
-  FILE* fp = _fs_native_open(buf, _FS_MWRITE);
-  return _fs_native_write(fp, data);
+  int fd = _fs_native_open(buf, _FS_MWRITE);
+  return _fs_native_write(fd, data);
+}
+
+bool fs_writev(const char* name, const fs_data* data, int count) {
+  FS_ASSERT(name && (data || count == 0) && count >= 0);
+  if (_fs_strempty(&_fs.write_dir)) {
+    return false;
+  }
+  char buf[FS_MAX_PATH];
+  if (!_fs_concat_path(buf, &_fs.write_dir, name)) {
+    return false;
+  }
+  int fd = _fs_native_open(buf, _FS_MWRITE);
+  return _fs_native_writev(fd, data, count);
 }
 
 bool fs_append(const char* name, const fs_data* data) {
@@ -523,15 +3318,262 @@ bool fs_append(const char* name, const fs_data* data) {
   if (!_fs_concat_path(buf, &_fs.write_dir, name)) {
     return false;
   }
-  FILE* fp = _fs_native_open(buf, _FS_MAPPEND);
-  return _fs_native_write(fp, data);
+  int fd = _fs_native_open(buf, _FS_MAPPEND);
+  return _fs_native_write(fd, data);
+}
+
+bool fs_write_async(const char* name, const fs_data* data) {
+  FS_ASSERT(name && data);
+  return _fs_write_async(name, data, _FS_MWRITE);
+}
+
+bool fs_append_async(const char* name, const fs_data* data) {
+  FS_ASSERT(name && data);
+  return _fs_write_async(name, data, _FS_MAPPEND);
+}
+
+bool fs_flush(void) {
+  _fs_writer_t* writer = &_fs.writer;
+  pthread_mutex_lock(&writer->lock);
+  while (writer->jobs > 0) {
+    pthread_cond_wait(&writer->done, &writer->lock);
+  }
+  bool ok = !writer->failed;
+  writer->failed = false;
+  pthread_mutex_unlock(&writer->lock);
+  return ok;
+}
+
+fs_appender* fs_appender_open(const char* name) {
+  FS_ASSERT(name);
+  if (_fs_strempty(&_fs.write_dir)) {
+    return NULL;
+  }
+  char buf[FS_MAX_PATH];
+  if (!_fs_concat_path(buf, &_fs.write_dir, name)) {
+    return NULL;
+  }
+  fs_appender* appender = (fs_appender*)FS_MALLOC(sizeof(fs_appender));
+  if (!appender) {
+    return NULL;
+  }
+  appender->fd = _fs_native_open(buf, _FS_MAPPEND);
+  appender->size = 0;
+  if (appender->fd < 0) {
+    FS_FREE(appender);
+    return NULL;
+  }
+  return appender;
+}
+
+bool fs_appender_write(fs_appender* appender, const fs_data* data) {
+  FS_ASSERT(appender && data);
+  if (appender->size + data->size > _FS_APPEND_BUFFER && !fs_appender_flush(appender)) {
+    return false;
+  }
+  /* too large to be worth buffering */
+  if (data->size >= _FS_APPEND_BUFFER) {
+    return _fs_native_write_all(appender->fd, data->data, data->size);
+  }
+  memcpy(appender->buf + appender->size, data->data, data->size);
+  appender->size += data->size;
+  return true;
+}
+
+bool fs_appender_flush(fs_appender* appender) {
+  FS_ASSERT(appender);
+  size_t count;
+  bool ok = _fs_native_write_count(appender->fd, appender->buf, appender->size, &count);
+  /* what could not be written is kept, and written by the next flush */
+  memmove(appender->buf, appender->buf + count, appender->size - count);
+  appender->size -= count;
+  return ok;
+}
+
+bool fs_appender_reserve(fs_appender* appender, size_t size) {
+  FS_ASSERT(appender);
+  return _fs_native_reserve(appender->fd, appender->size + size) == 0;
+}
+
+bool fs_appender_close(fs_appender* appender) {
+  if (appender == NULL) {
+    return false;
+  }
+  bool ok = fs_appender_flush(appender);
+  ok = (close(appender->fd) == 0) && ok;
+  FS_FREE(appender);
+  return ok;
+}
+
+fs_framed* fs_framed_open(const char* name) {
+  FS_ASSERT(name);
+  if (_fs_strempty(&_fs.write_dir)) {
+    return NULL;
+  }
+  char buf[FS_MAX_PATH];
+  if (!_fs_concat_path(buf, &_fs.write_dir, name)) {
+    return NULL;
+  }
+  fs_framed* framed = (fs_framed*)FS_MALLOC(sizeof(fs_framed));
+  if (!framed) {
+    return NULL;
+  }
+  framed->fd = _fs_native_open(buf, _FS_MAPPEND);
+  if (framed->fd < 0) {
+    FS_FREE(framed);
+    return NULL;
+  }
+  return framed;
+}
+
+bool fs_framed_append(fs_framed* framed, const fs_data* data) {
+  FS_ASSERT(framed && data);
+  if (data->size > FS_MAX_RECORD) {
+    return false;
+  }
+  const uint32_t size = (uint32_t)data->size;
+  unsigned char header[4] = {
+    (unsigned char)size, (unsigned char)(size >> 8), (unsigned char)(size >> 16), (unsigned char)(size >> 24),
+  };
+  struct iovec iov[2] = {
+    { header, sizeof(header) },
+    { (void*)data->data, data->size },
+  };
+  /* with O_APPEND the whole frame is written at the end of the file at once, no lock is needed */
+  ssize_t ret;
+  while ((ret = writev(framed->fd, iov, 2)) < 0 && errno == EINTR);
+  /* the rest of a short write cannot be appended without splitting the frame */
+  return ret == (ssize_t)(sizeof(header) + data->size);
+}
+
+bool fs_framed_close(fs_framed* framed) {
+  if (framed == NULL) {
+    return false;
+  }
+  bool ok = (close(framed->fd) == 0);
+  FS_FREE(framed);
+  return ok;
+}
+
+fs_log* fs_log_open(const char* name, long window_us) {
+  FS_ASSERT(name && window_us >= 0);
+  if (_fs_strempty(&_fs.write_dir)) {
+    return NULL;
+  }
+  char buf[FS_MAX_PATH];
+  if (!_fs_concat_path(buf, &_fs.write_dir, name)) {
+    return NULL;
+  }
+  fs_log* log = (fs_log*)FS_MALLOC(sizeof(fs_log));
+  if (!log) {
+    return NULL;
+  }
+  memset(log, 0, sizeof(fs_log));
+  log->fd = _fs_native_open(buf, _FS_MAPPEND);
+  /* an empty file may have just been created, its directory entry must be durable too */
+  size_t size;
+  if (log->fd >= 0 && (!_fs_native_size(log->fd, &size) || (size == 0 && !_fs_native_sync_dir(buf)))) {
+    close(log->fd);
+    log->fd = -1;
+  }
+  if (log->fd < 0) {
+    FS_FREE(log);
+    return NULL;
+  }
+  log->window_us = window_us;
+  log->batch = 1;
+  pthread_mutex_init(&log->lock, NULL);
+  pthread_cond_init(&log->cond, NULL);
+  return log;
+}
+
+bool fs_log_append(fs_log* log, const fs_data* data) {
+  FS_ASSERT(log && data);
+  pthread_mutex_lock(&log->lock);
+  /* after a failed write nothing more is appended, the end of the file is unknown */
+  if (log->failed) {
+    pthread_mutex_unlock(&log->lock);
+    return false;
+  }
+  if (log->count == log->capacity) {
+    int capacity = _fs_def(log->capacity * 2, 64);
+    fs_data* records = (fs_data*)FS_MALLOC(capacity * sizeof(fs_data));
+    if (!records) {
+      pthread_mutex_unlock(&log->lock);
+      return false;
+    }
+    if (log->count > 0) {
+      memcpy(records, log->records, log->count * sizeof(fs_data));
+    }
+    FS_FREE(log->records);
+    log->records = records;
+    log->capacity = capacity;
+  }
+  /* the caller waits until its batch is written, so its data is not copied */
+  log->records[log->count++] = *data;
+  const uint64_t batch = log->batch;
+  while (log->durable < batch && !log->failed) {
+    if (log->syncing) {
+      pthread_cond_wait(&log->cond, &log->lock);
+      continue;
+    }
+    /* the first caller of a batch writes it, after giving others time to join */
+    log->syncing = true;
+    if (log->window_us > 0) {
+      pthread_mutex_unlock(&log->lock);
+      struct timespec ts = { log->window_us / 1000000, (log->window_us % 1000000) * 1000 };
+      while (nanosleep(&ts, &ts) < 0 && errno == EINTR);
+      pthread_mutex_lock(&log->lock);
+    }
+    fs_data* records = log->records;
+    const int count = log->count;
+    const int capacity = log->capacity;
+    const uint64_t closed = log->batch++;
+    log->records = log->spare;
+    log->capacity = log->spare_capacity;
+    log->count = 0;
+    pthread_mutex_unlock(&log->lock);
+
+    bool ok = _fs_native_writev_all(log->fd, records, count) && _fs_native_sync(log->fd);
+
+    pthread_mutex_lock(&log->lock);
+    log->spare = records;
+    log->spare_capacity = capacity;
+    log->durable = closed;
+    if (!ok && !log->failed) {
+      /* the callers of the open batch fail too, and stop referencing their data */
+      log->failed = closed;
+      log->count = 0;
+    }
+    log->syncing = false;
+    pthread_cond_broadcast(&log->cond);
+  }
+  /* a batch written before the failure is still on the device */
+  bool ok = !log->failed || batch < log->failed;
+  pthread_mutex_unlock(&log->lock);
+  return ok;
+}
+
+bool fs_log_close(fs_log* log) {
+  if (log == NULL) {
+    return false;
+  }
+  bool ok = (close(log->fd) == 0) && !log->failed;
+  pthread_cond_destroy(&log->cond);
+  pthread_mutex_destroy(&log->lock);
+  FS_FREE(log->records);
+  FS_FREE(log->spare);
+  FS_FREE(log);
+  return ok;
 }
 
 bool fs_get_info(const char* path, fs_info* info) {
   FS_ASSERT(path && info);
   char buf[FS_MAX_PATH];
-  _fs_path* dir = &_fs.base_path[_fs.count - 1];
-  for (; dir >= _fs.base_path; dir--) {
+  _fs_search_t search;
+  _fs_search_path(&search);
+  _fs_path* dir = &search.base_path[search.count - 1];
+  for (; dir >= search.base_path; dir--) {
     if (_fs_concat_path(buf, dir, path) && _fs_get_file_info(buf, info)) {
       return true;
     }
@@ -558,6 +3600,38 @@ bool fs_mkdir(const char* path) {
   return _fs_native_mkdir(buf);
 }
 
+bool fs_copy(const char* src, const char* dst) {
+  FS_ASSERT(src && dst);
+  if (_fs_strempty(&_fs.write_dir)) {
+    return false;
+  }
+  char buf[FS_MAX_PATH];
+  if (!_fs_concat_path(buf, &_fs.write_dir, dst)) {
+    return false;
+  }
+  int in = _fs_resolve_open(src);
+  if (in < 0) {
+    return false;
+  }
+  /* e.g. a directory, checked before the destination is created */
+  size_t size;
+  if (!_fs_native_size(in, &size)) {
+    close(in);
+    return false;
+  }
+  /* a destination this call created is removed again if the copy fails */
+  int out = _fs_native_open(buf, _FS_MCREATE);
+  bool created = (out >= 0);
+  if (!created && errno == EEXIST) {
+    out = _fs_native_open(buf, _FS_MUPDATE);
+  }
+  bool ok = _fs_native_copy(in, out);
+  if (!ok && created) {
+    _fs_native_delete(buf);
+  }
+  return ok;
+}
+
 bool fs_delete(const char* name) {
   FS_ASSERT(name);
   if (_fs_strempty(&_fs.write_dir)) {
@@ -571,7 +3645,19 @@ bool fs_delete(const char* name) {
 }
 
 inline void fs_free(void* p) {
+  if (p != NULL && _fs.cache.capacity > 0) {
+    pthread_mutex_lock(&_fs.cache.lock);
+    bool shared = _fs_cache_release(&_fs.cache, p);
+    pthread_mutex_unlock(&_fs.cache.lock);
+    if (shared) {
+      return;
+    }
+  }
   FS_FREE(p);
 }
 
+void fs_free_aligned(void* p) {
+  _fs_free_aligned(p);
+}
+
 #endif /* FS_IMPLEMENTATION */
\ No newline at end of file
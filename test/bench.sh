@@ -0,0 +1,11 @@
+#!/bin/bash
+
+# build benchmark
+gcc -std=c99 -O2 -D_GNU_SOURCE -pthread -o fs_bench fs_bench.c -I./../src
+
+# run the benchmark
+echo "benchmarking filesystem..."
+./fs_bench
+
+# cleanup
+rm -f fs_bench
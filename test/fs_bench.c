@@ -0,0 +1,154 @@
+#include <time.h>
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+
+#define FS_IMPL
+#include "filesystem.h"
+
+/*
+    compares `fs_read()` against the stdio read path it replaced:
+
+      stdio: stat, fopen, fseek, ftell, fseek, fread, fclose
+      fs:    open, fstat, read, close
+
+    the number of system calls per file is counted by tracing a child
+    process with ptrace. timings depend on the machine and on the page
+    cache, and on a warm cache the two paths are often close; the system
+    call count is what the new path reduces.
+*/
+
+enum {
+  BENCH_FILES = 64,
+  BENCH_ROUNDS = 200,
+  BENCH_FILE_SIZE = 4096,
+};
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void* stdio_read(const char* name, size_t* size) {
+  struct stat st;
+  if (stat(name, &st) != 0) {
+    return NULL;
+  }
+  FILE* fp = fopen(name, "rb");
+  if (fp == NULL) {
+    return NULL;
+  }
+  fseek(fp, 0, SEEK_END);
+  *size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  void* buf = malloc(*size);
+  if (buf) {
+    fread(buf, 1, *size, fp);
+  }
+  fclose(fp);
+  return buf;
+}
+
+static char names[BENCH_FILES][32];
+
+static void bench_stdio(void) {
+  for (int i = 0; i < BENCH_FILES; i++) {
+    size_t size;
+    free(stdio_read(names[i], &size));
+  }
+}
+
+static void bench_fs(void) {
+  for (int i = 0; i < BENCH_FILES; i++) {
+    size_t size;
+    fs_free(fs_read(names[i], &size));
+  }
+}
+
+static void bench_none(void) {
+}
+
+/* runs `fn` in a traced child, returns the number of system calls it made or -1 */
+static long bench_syscalls(void (*fn)(void)) {
+  pid_t pid = fork();
+  if (pid < 0) {
+    return -1;
+  }
+  if (pid == 0) {
+    if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) != 0) {
+      _exit(1);
+    }
+    raise(SIGSTOP);
+    fn();
+    _exit(0);
+  }
+  int status;
+  long stops = 0;
+  waitpid(pid, &status, 0);
+  if (!WIFSTOPPED(status)) {
+    return -1;
+  }
+  ptrace(PTRACE_SETOPTIONS, pid, NULL, (void*)PTRACE_O_TRACESYSGOOD);
+  for (;;) {
+    if (ptrace(PTRACE_SYSCALL, pid, NULL, NULL) != 0) {
+      break;
+    }
+    waitpid(pid, &status, 0);
+    if (WIFEXITED(status) || WIFSIGNALED(status)) {
+      break;
+    }
+    if (WIFSTOPPED(status) && WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+      stops++;
+    }
+  }
+  /* every call stops on entry and on exit, exit_group only on entry */
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? (stops + 1) / 2 : -1;
+}
+
+int main(void) {
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  static char payload[BENCH_FILE_SIZE];
+  memset(payload, 'x', sizeof(payload));
+  for (int i = 0; i < BENCH_FILES; i++) {
+    sprintf(names[i], "bench_%d.bin", i);
+    fs_write(names[i], &(fs_data) { payload, sizeof(payload) });
+  }
+
+  /* the first allocation may grow the heap, so the allocator is warmed up first */
+  bench_stdio();
+  bench_fs();
+  long none = bench_syscalls(bench_none);
+  long stdio_calls = bench_syscalls(bench_stdio);
+  long fs_calls = bench_syscalls(bench_fs);
+
+  double start = bench_now();
+  for (int r = 0; r < BENCH_ROUNDS; r++) {
+    bench_stdio();
+  }
+  double stdio_time = bench_now() - start;
+
+  start = bench_now();
+  for (int r = 0; r < BENCH_ROUNDS; r++) {
+    bench_fs();
+  }
+  double fs_time = bench_now() - start;
+
+  const double reads = (double)BENCH_FILES * BENCH_ROUNDS;
+  if (none < 0 || stdio_calls < 0 || fs_calls < 0) {
+    printf("system calls could not be counted (ptrace is not permitted)\n");
+  } else {
+    printf("stdio read:  %8.2f syscalls/file\n", (double)(stdio_calls - none) / BENCH_FILES);
+    printf("fs_read:     %8.2f syscalls/file\n", (double)(fs_calls - none) / BENCH_FILES);
+  }
+  printf("stdio read:  %8.2f us/file\n", stdio_time * 1e6 / reads);
+  printf("fs_read:     %8.2f us/file\n", fs_time * 1e6 / reads);
+
+  for (int i = 0; i < BENCH_FILES; i++) {
+    fs_delete(names[i]);
+  }
+  fs_shutdown();
+  return 0;
+}
@@ -1,5 +1,10 @@
 #include "acutest.h"
 
+#include <sys/resource.h> /* setrlimit */
+#if defined(__linux__)
+  #include <sys/vfs.h> /* statfs */
+#endif
+
 #define FS_IMPL
 #include "filesystem.h"
 
@@ -39,17 +44,19 @@ void test__fs_native_open(void) {
   FILE *fp; const char* str = "The quick brown fox jumps over the lazy dog.";
   fp = fopen("is_a_file.txt" , "wb");
   fwrite(str, 1, strlen(str), fp);
+  fclose(fp);
+  int fd;
 
   TEST_CASE("open file (for read) that doesn't exist");
-  fp = _fs_native_open("not_a_file.txt", _FS_MREAD);
-  TEST_CHECK(fp == NULL);
+  fd = _fs_native_open("not_a_file.txt", _FS_MREAD);
+  TEST_CHECK(fd < 0);
 
   TEST_CASE("open file (for read) that does exist");
-  fp = _fs_native_open("is_a_file.txt", _FS_MREAD);
-  TEST_CHECK(fp != NULL);
+  fd = _fs_native_open("is_a_file.txt", _FS_MREAD);
+  TEST_CHECK(fd >= 0);
 
   /* cleanup */
-  fclose(fp);
+  close(fd);
   remove("is_a_file.txt");
 }
 
@@ -58,42 +65,46 @@ void test__fs_native_read(void) {
   FILE *fp; const char* str = "The quick brown fox jumps over the lazy dog.";
   fp = fopen("is_a_file.txt" , "wb");
   fwrite(str, 1, strlen(str), fp);
+  fclose(fp);
   size_t size;
+  int fd;
 
   TEST_CASE("read from null file");
-  TEST_CHECK(_fs_native_read(NULL, &size) == NULL);
+  TEST_CHECK(_fs_native_read(-1, &size) == NULL);
 
-  fp = fopen("not_a_file.txt", "rb");
+  fd = open("not_a_file.txt", O_RDONLY);
   TEST_CASE("read file that doesn't exist");
-  TEST_CHECK(_fs_native_read(fp, &size) == NULL);
+  TEST_CHECK(_fs_native_read(fd, &size) == NULL);
 
-  fp = fopen("is_a_file.txt", "rb");
+  fd = open("is_a_file.txt", O_RDONLY);
   TEST_CASE("read file that does exist");
-  TEST_CHECK(_fs_native_read(fp, &size) != NULL);
+  char* data = _fs_native_read(fd, &size);
+  TEST_CHECK(data != NULL);
+  TEST_CHECK(size == strlen(str));
+  TEST_CHECK(memcmp(data, str, size) == 0);
 
   /* cleanup */
-  fclose(fp);
+  fs_free(data);
   remove("is_a_file.txt");
 }
 
 void test__fs_native_write(void) {
-  FILE *fp = NULL;
+  int fd = -1;
   const char* str = "The quick brown fox jumps over the lazy dog.";
   fs_data desc = { .data = str, .size = strlen(str) };
 
   TEST_CASE("write to null file");
-  TEST_CHECK(_fs_native_write(NULL, &desc) == false);
+  TEST_CHECK(_fs_native_write(fd, &desc) == false);
 
-  fp = fopen("test_write.txt", "w");
+  fd = open("test_write.txt", O_WRONLY | O_CREAT | O_TRUNC, 0666);
   TEST_CASE("read file that doesn't exist");
-  TEST_CHECK(_fs_native_write(fp, &desc) == true);
+  TEST_CHECK(_fs_native_write(fd, &desc) == true);
 
-  fp = fopen("test_write.txt", "w");
+  fd = open("test_write.txt", O_WRONLY | O_CREAT | O_TRUNC, 0666);
   TEST_CASE("read file that does exist");
-  TEST_CHECK(_fs_native_write(fp, &desc) == true);
+  TEST_CHECK(_fs_native_write(fd, &desc) == true);
 
   /* cleanup */
-  fclose(fp);
   remove("test_write.txt");
 }
 
@@ -147,6 +158,305 @@ void test_fs_append(void) {
   fs_delete("is_a_file.txt");
 }
 
+void test_fs_copy(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  TEST_CASE("copy file that doesn't exist");
+  if (TEST_CHECK(!fs_exists("not_a_file.txt"))) {
+    TEST_CHECK(fs_copy("not_a_file.txt", "is_a_copy.txt") == false);
+    TEST_CHECK(fs_exists("is_a_copy.txt") == false);
+  }
+
+  TEST_CASE("copy a directory");
+  if (TEST_CHECK(fs_mkdir("is_a_dir"))) {
+    TEST_CHECK(fs_copy("is_a_dir", "is_a_copy.txt") == false);
+    TEST_CHECK(fs_exists("is_a_copy.txt") == false);
+    fs_delete("is_a_dir");
+  }
+
+  TEST_CASE("copy file that does exist");
+  static char big[3 * 1024 * 1024 + 7];
+  for (size_t i = 0; i < sizeof(big); i++) {
+    big[i] = (char) (i * 31);
+  }
+  fs_write("is_a_file.txt", &(fs_data) { big, sizeof(big) });
+  if (TEST_CHECK(fs_exists("is_a_file.txt"))) {
+    TEST_CHECK(fs_copy("is_a_file.txt", "is_a_copy.txt") == true);
+
+    size_t size;
+    char* data = fs_read("is_a_copy.txt", &size);
+    TEST_CHECK(data != NULL);
+    TEST_CHECK(size == sizeof(big));
+    TEST_CHECK(memcmp(data, big, size) == 0);
+    fs_free(data);
+  }
+
+  TEST_CASE("copy file onto itself");
+  TEST_CHECK(fs_copy("is_a_file.txt", "is_a_file.txt") == false);
+  fs_info info;
+  TEST_CHECK(fs_get_info("is_a_file.txt", &info) == true);
+  TEST_CHECK(info.size == sizeof(big));
+
+  TEST_CASE("copy file over a larger file");
+  const char* str = "The quick brown fox jumps over the lazy dog.";
+  fs_write("is_a_small_file.txt", FS_DATA_STR_REF(str));
+  TEST_CHECK(fs_copy("is_a_small_file.txt", "is_a_copy.txt") == true);
+  TEST_CHECK(fs_get_info("is_a_copy.txt", &info) == true);
+  TEST_CHECK(info.size == strlen(str));
+  fs_delete("is_a_small_file.txt");
+
+  TEST_CASE("copy buffered when the kernel can't copy");
+  int in = open("is_a_file.txt", O_RDONLY);
+  int out = open("is_a_copy.txt", O_WRONLY | O_TRUNC);
+  int method = _FS_COPY_BUFFER;
+  TEST_CHECK(_fs_native_copy_chunk(in, out, 0, sizeof(big), &method) == 1024 * 1024);
+  close(in);
+  close(out);
+
+  /* cleanup */
+  fs_delete("is_a_file.txt");
+  fs_delete("is_a_copy.txt");
+}
+
+/* true when the working directory is on a filesystem known to support preallocation */
+static bool test_can_reserve(void) {
+#if defined(__linux__)
+  struct statfs fs;
+  if (statfs(".", &fs) != 0) {
+    return false;
+  }
+  return fs.f_type == 0xEF53        /* ext4 */
+      || fs.f_type == 0x58465342    /* xfs */
+      || fs.f_type == 0x9123683E    /* btrfs */
+      || fs.f_type == 0x01021994;   /* tmpfs */
+#else
+  return false;
+#endif
+}
+
+void test_fs_appender(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  TEST_CASE("append to file many times");
+  fs_appender* appender = fs_appender_open("is_a_file.txt");
+  if (TEST_CHECK(appender != NULL)) {
+    const char* words[] = { "The quick", " brown fox", " jumps over", " the lazy dog." };
+    for (int i = 0; i < 4; i++) {
+      TEST_CHECK(fs_appender_write(appender, FS_DATA_STR_REF(words[i])) == true);
+    }
+    TEST_CHECK(fs_appender_flush(appender) == true);
+
+    size_t size;
+    char* data = fs_read("is_a_file.txt", &size);
+    const char* full = "The quick brown fox jumps over the lazy dog.";
+    TEST_CHECK(data != NULL);
+    TEST_CHECK(size == strlen(full));
+    TEST_CHECK(memcmp(data, full, size) == 0);
+    fs_free(data);
+
+    TEST_CASE("append more than the buffer holds");
+    static char big[100000];
+    memset(big, 'x', sizeof(big));
+    TEST_CHECK(fs_appender_write(appender, &(fs_data) { big, sizeof(big) }) == true);
+    TEST_CHECK(fs_appender_write(appender, FS_DATA_STR_REF(words[0])) == true);
+    TEST_CHECK(fs_appender_close(appender) == true);
+
+    fs_info info;
+    TEST_CHECK(fs_get_info("is_a_file.txt", &info) == true);
+    TEST_CHECK(info.size == strlen(full) + sizeof(big) + strlen(words[0]));
+  }
+
+  TEST_CASE("reserve space without changing the size");
+  appender = fs_appender_open("is_a_file.txt");
+  if (TEST_CHECK(appender != NULL)) {
+    fs_info before, after;
+    TEST_CHECK(fs_get_info("is_a_file.txt", &before) == true);
+    bool reserved = fs_appender_reserve(appender, 4 * 1024 * 1024);
+    if (test_can_reserve()) {
+      struct stat st;
+      TEST_CHECK(reserved == true);
+      TEST_CHECK(stat("is_a_file.txt", &st) == 0 && st.st_blocks * 512 >= 4 * 1024 * 1024);
+    }
+    TEST_CHECK(fs_get_info("is_a_file.txt", &after) == true);
+    TEST_CHECK(after.size == before.size);
+    const char* str = "The quick brown fox";
+    TEST_CHECK(fs_appender_write(appender, FS_DATA_STR_REF(str)) == true);
+    TEST_CHECK(fs_appender_close(appender) == true);
+    TEST_CHECK(fs_get_info("is_a_file.txt", &after) == true);
+    TEST_CHECK(after.size == before.size + strlen(str));
+  }
+  fs_delete("is_a_file.txt");
+
+  TEST_CASE("flush that fails keeps the data");
+  appender = fs_appender_open("is_a_file.txt");
+  if (TEST_CHECK(appender != NULL)) {
+    const char* str = "The quick brown fox";
+    TEST_CHECK(fs_appender_write(appender, FS_DATA_STR_REF(str)) == true);
+    /* writing to a descriptor opened for reading fails with EBADF */
+    int fd = dup(appender->fd);
+    int ro = open("is_a_file.txt", O_RDONLY);
+    dup2(ro, appender->fd);
+    close(ro);
+    TEST_CHECK(fs_appender_flush(appender) == false);
+    dup2(fd, appender->fd);
+    close(fd);
+    TEST_CHECK(fs_appender_close(appender) == true);
+
+    size_t size;
+    char* data = fs_read("is_a_file.txt", &size);
+    TEST_CHECK(data != NULL);
+    TEST_CHECK(size == strlen(str));
+    TEST_CHECK(data && memcmp(data, str, size) == 0);
+    fs_free(data);
+  }
+
+  /* cleanup */
+  fs_delete("is_a_file.txt");
+}
+
+static void* test_log_writer(void* arg) {
+  fs_log* log = (fs_log*) arg;
+  for (int i = 0; i < 50; i++) {
+    TEST_CHECK(fs_log_append(log, &(fs_data) { "0123456789\n", 11 }) == true);
+  }
+  return NULL;
+}
+
+static void* test_framed_writer(void* arg) {
+  fs_framed* framed = (fs_framed*) arg;
+  char record[300];
+  for (int i = 0; i < 100; i++) {
+    memset(record, 'a' + i % 26, sizeof(record));
+    TEST_CHECK(fs_framed_append(framed, &(fs_data) { record, (size_t) (i * 3) }) == true);
+  }
+  return NULL;
+}
+
+void test_fs_framed(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  TEST_CASE("append records from many threads");
+  fs_framed* framed = fs_framed_open("is_a_file.txt");
+  if (TEST_CHECK(framed != NULL)) {
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) {
+      pthread_create(&threads[i], NULL, test_framed_writer, framed);
+    }
+    for (int i = 0; i < 4; i++) {
+      pthread_join(threads[i], NULL);
+    }
+
+    TEST_CASE("append record larger than the limit");
+    static char big[FS_MAX_RECORD + 1];
+    TEST_CHECK(fs_framed_append(framed, &(fs_data) { big, sizeof(big) }) == false);
+    TEST_CHECK(fs_framed_close(framed) == true);
+
+    TEST_CASE("records are not interleaved");
+    size_t size;
+    unsigned char* data = fs_read("is_a_file.txt", &size);
+    TEST_CHECK(data != NULL);
+    int count = 0;
+    size_t pos = 0;
+    while (data && pos + 4 <= size) {
+      size_t len = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16) | ((size_t) data[pos + 3] << 24);
+      pos += 4;
+      if (!TEST_CHECK(pos + len <= size && len % 3 == 0)) {
+        break;
+      }
+      char c = (char) ('a' + (len / 3) % 26);
+      bool same = true;
+      for (size_t i = 0; i < len; i++) {
+        same = same && data[pos + i] == c;
+      }
+      TEST_CHECK(same);
+      pos += len;
+      count++;
+    }
+    TEST_CHECK(pos == size);
+    TEST_CHECK(count == 400);
+    fs_free(data);
+  }
+
+  /* cleanup */
+  fs_delete("is_a_file.txt");
+}
+
+void test_fs_log(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  TEST_CASE("append to log from one thread");
+  fs_log* log = fs_log_open("is_a_file.txt", 0);
+  if (TEST_CHECK(log != NULL)) {
+    const char* str = "The quick brown fox jumps over the lazy dog.";
+    TEST_CHECK(fs_log_append(log, FS_DATA_STR_REF(str)) == true);
+
+    size_t size;
+    char* data = fs_read("is_a_file.txt", &size);
+    TEST_CHECK(data != NULL);
+    TEST_CHECK(size == strlen(str));
+    TEST_CHECK(memcmp(data, str, size) == 0);
+    fs_free(data);
+    TEST_CHECK(fs_log_close(log) == true);
+  }
+  fs_delete("is_a_file.txt");
+
+  TEST_CASE("append to log from many threads");
+  log = fs_log_open("is_a_file.txt", 100);
+  if (TEST_CHECK(log != NULL)) {
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) {
+      pthread_create(&threads[i], NULL, test_log_writer, log);
+    }
+    for (int i = 0; i < 4; i++) {
+      pthread_join(threads[i], NULL);
+    }
+    TEST_CHECK(fs_log_close(log) == true);
+
+    size_t size;
+    char* data = fs_read("is_a_file.txt", &size);
+    TEST_CHECK(data != NULL);
+    TEST_CHECK(size == 4 * 50 * 11);
+    for (size_t i = 0; data && i < size; i += 11) {
+      TEST_CHECK(memcmp(data + i, "0123456789\n", 11) == 0);
+    }
+    fs_free(data);
+  }
+  fs_delete("is_a_file.txt");
+
+  TEST_CASE("append to log after a failed write");
+  log = fs_log_open("is_a_file.txt", 0);
+  if (TEST_CHECK(log != NULL)) {
+    const char* str = "The quick brown fox";
+    TEST_CHECK(fs_log_append(log, FS_DATA_STR_REF(str)) == true);
+    /* writing to a descriptor opened for reading fails with EBADF */
+    int fd = dup(log->fd);
+    int ro = open("is_a_file.txt", O_RDONLY);
+    dup2(ro, log->fd);
+    close(ro);
+    TEST_CHECK(fs_log_append(log, FS_DATA_STR_REF(str)) == false);
+    dup2(fd, log->fd);
+    close(fd);
+    TEST_CHECK(fs_log_append(log, FS_DATA_STR_REF(str)) == false);
+    TEST_CHECK(log->count == 0);
+    TEST_CHECK(fs_log_close(log) == false);
+
+    fs_info info;
+    TEST_CHECK(fs_get_info("is_a_file.txt", &info) == true);
+    TEST_CHECK(info.size == strlen(str));
+  }
+
+  /* cleanup */
+  fs_delete("is_a_file.txt");
+}
+
 void test_fs_delete(void) {
   /* setup filesystem */
   char* cwd = (char*) fs_get_cwd();
@@ -206,6 +516,55 @@ void test_fs_get_cwd(void) {
   TEST_CHECK(cwd != NULL);
 }
 
+void test_fs_hash(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  /* create a file with the standard check input */
+  const char* str = "123456789";
+  fs_write("is_a_file.txt", FS_DATA_STR_REF(str));
+
+  uint32_t hash;
+
+  TEST_CASE("hash file that doesn't exist");
+  if (TEST_CHECK(!fs_exists("not_a_file.txt"))) {
+    TEST_CHECK(fs_hash("not_a_file.txt", &hash) == false);
+  }
+
+  TEST_CASE("hash file that does exist");
+  if (TEST_CHECK(fs_exists("is_a_file.txt"))) {
+    TEST_CHECK(fs_hash("is_a_file.txt", &hash) == true);
+    TEST_CHECK(hash == 0xE3069283u);
+  }
+
+  TEST_CASE("read and hash file that does exist");
+  if (TEST_CHECK(fs_exists("is_a_file.txt"))) {
+    size_t size;
+    hash = 0;
+    char* data = fs_read_hashed("is_a_file.txt", &size, &hash);
+    TEST_CHECK(data != NULL);
+    TEST_CHECK(size == strlen(str));
+    TEST_CHECK(hash == 0xE3069283u);
+    fs_free(data);
+  }
+
+  TEST_CASE("hash file larger than a chunk");
+  static char big[600000];
+  memset(big, 'x', sizeof(big));
+  fs_write("is_a_file.txt", &(fs_data) { big, sizeof(big) });
+  uint32_t streamed = 0, read = 1;
+  size_t size;
+  char* data = fs_read_hashed("is_a_file.txt", &size, &read);
+  TEST_CHECK(fs_hash("is_a_file.txt", &streamed) == true);
+  TEST_CHECK(streamed == read);
+  TEST_CHECK(streamed == (_fs_crc32c(0xFFFFFFFFu, big, sizeof(big)) ^ 0xFFFFFFFFu));
+  fs_free(data);
+
+  /* cleanup */
+  fs_delete("is_a_file.txt");
+}
+
 void test_fs_get_info(void) {
   /* setup filesystem */
   char* cwd = (char*) fs_get_cwd();
@@ -245,10 +604,183 @@ void test_fs_get_info(void) {
   fs_delete("is_a_file.txt");
 }
 
+void test_fs_map(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  /* create a file */
+  const char* str = "The quick brown fox jumps over the lazy dog.";
+  fs_write("is_a_file.txt", FS_DATA_STR_REF(str));
+
+  TEST_CASE("map file that doesn't exist");
+  if (TEST_CHECK(!fs_exists("not_a_file.txt"))) {
+    size_t size;
+    const char* data = fs_map("not_a_file.txt", &size);
+
+    TEST_CHECK(data == NULL);
+  }
+
+  TEST_CASE("map file that does exist");
+  if (TEST_CHECK(fs_exists("is_a_file.txt"))) {
+    size_t size;
+    const char* data = fs_map("is_a_file.txt", &size);
+
+    TEST_CHECK(data != NULL);
+    TEST_CHECK(size == strlen(str));
+    TEST_CHECK(memcmp(data, str, size) == 0);
+    fs_unmap(data, size);
+  }
+
+  /* cleanup */
+  fs_delete("is_a_file.txt");
+}
+
+void test_fs_map_write(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  /* create a larger file to be replaced */
+  const char* str = "The quick brown fox jumps over the lazy dog.";
+  fs_write("is_a_file.txt", FS_DATA_STR_REF(str));
+
+  TEST_CASE("map empty file for writing");
+  TEST_CHECK(fs_map_write("is_a_file.txt", 0) == NULL);
+
+  TEST_CASE("map file that is too large for writing");
+  if (TEST_CHECK(!fs_exists("not_a_file.txt"))) {
+    TEST_CHECK(fs_map_write("not_a_file.txt", (size_t) 1 << 62) == NULL);
+    TEST_CHECK(fs_exists("not_a_file.txt") == false);
+  }
+
+  TEST_CASE("map file for writing");
+  char* out = (char*) fs_map_write("is_a_file.txt", 16);
+  if (TEST_CHECK(out != NULL)) {
+    TEST_CHECK(out[15] == 0);
+    memcpy(out, "The quick brown", 15);
+    TEST_CHECK(fs_map_commit(out, 16) == true);
+
+    size_t size;
+    char* data = fs_read("is_a_file.txt", &size);
+    TEST_CHECK(data != NULL);
+    TEST_CHECK(size == 16);
+    TEST_CHECK(data && memcmp(data, "The quick brown", 16) == 0);
+    fs_free(data);
+  }
+
+  TEST_CASE("map large file for writing");
+  const size_t len = 2 * 1024 * 1024;
+  out = (char*) fs_map_write("is_a_file.txt", len);
+  if (TEST_CHECK(out != NULL)) {
+    out[len - 1] = 'x';
+    TEST_CHECK(fs_map_commit(out, len) == true);
+    fs_info info;
+    TEST_CHECK(fs_get_info("is_a_file.txt", &info) == true);
+    TEST_CHECK(info.size == len);
+  }
+
+  /* cleanup */
+  fs_delete("is_a_file.txt");
+}
+
+void test_fs_open(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  /* create a file */
+  const char* str = "The quick brown fox jumps over the lazy dog.";
+  fs_write("is_a_file.txt", FS_DATA_STR_REF(str));
+
+  TEST_CASE("open file that doesn't exist");
+  if (TEST_CHECK(!fs_exists("not_a_file.txt"))) {
+    TEST_CHECK(fs_open("not_a_file.txt") == NULL);
+  }
+
+  TEST_CASE("read file that does exist in chunks");
+  if (TEST_CHECK(fs_exists("is_a_file.txt"))) {
+    fs_file* file = fs_open("is_a_file.txt");
+    if (TEST_CHECK(file != NULL)) {
+      char chunk[16], data[64];
+      size_t n, size = 0;
+      while ((n = fs_read_chunk(file, chunk, sizeof(chunk))) > 0) {
+        TEST_CHECK(n <= sizeof(chunk));
+        memcpy(data + size, chunk, n);
+        size += n;
+      }
+      TEST_CHECK(size == strlen(str));
+      TEST_CHECK(memcmp(data, str, size) == 0);
+      TEST_CHECK(fs_file_error(file) == false);
+      fs_close(file);
+    }
+  }
+
+  TEST_CASE("read file in chunks that fails");
+  fs_file* file = fs_open("is_a_file.txt");
+  if (TEST_CHECK(file != NULL)) {
+    /* reading a directory fails with EISDIR */
+    int dir = open(cwd, O_RDONLY);
+    dup2(dir, file->fd);
+    close(dir);
+    char chunk[16];
+    TEST_CHECK(fs_read_chunk(file, chunk, sizeof(chunk)) == 0);
+    TEST_CHECK(fs_file_error(file) == true);
+    fs_close(file);
+  }
+
+  /* cleanup */
+  fs_delete("is_a_file.txt");
+}
+
 void test_fs_mkdir(void) {
   /* body */
 }
 
+void test_fs_prefetch(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  /* create a file */
+  const char* str = "The quick brown fox jumps over the lazy dog.";
+  fs_write("is_a_file.txt", FS_DATA_STR_REF(str));
+
+  TEST_CASE("prefetch file that doesn't exist");
+  if (TEST_CHECK(!fs_exists("not_a_file.txt"))) {
+    TEST_CHECK(fs_prefetch("not_a_file.txt") == false);
+  }
+
+  TEST_CASE("prefetch file that does exist");
+  if (TEST_CHECK(fs_exists("is_a_file.txt"))) {
+    TEST_CHECK(fs_prefetch("is_a_file.txt") == true);
+  }
+
+  TEST_CASE("advise an opened file");
+  fs_file* file = fs_open("is_a_file.txt");
+  if (TEST_CHECK(file != NULL)) {
+    TEST_CHECK(fs_advise(file, FS_ACCESS_SEQUENTIAL) == true);
+    fs_close(file);
+  }
+
+  TEST_CASE("advise a mapped file");
+  size_t size;
+  const void* data = fs_map("is_a_file.txt", &size);
+  if (TEST_CHECK(data != NULL)) {
+    TEST_CHECK(fs_advise_map(data, size, FS_ACCESS_RANDOM) == true);
+    fs_unmap(data, size);
+  }
+
+  TEST_CASE("advise with an access pattern that doesn't exist");
+  int fd = open("is_a_file.txt", O_RDONLY);
+  TEST_CHECK(_fs_native_advise(fd, (fs_access) 99) == false);
+  TEST_CHECK(_fs_native_advise(fd, (fs_access) -1) == false);
+  close(fd);
+
+  /* cleanup */
+  fs_delete("is_a_file.txt");
+}
+
 void test_fs_read(void) {
   /* setup filesystem */
   char* cwd = (char*) fs_get_cwd();
@@ -279,6 +811,426 @@ void test_fs_read(void) {
   fs_delete("is_a_file.txt");
 }
 
+typedef struct {
+  bool called;
+  bool has_data;
+  size_t size;
+} test_async_t;
+
+static void test_async_callback(const char* name, void* data, size_t size, void* userdata) {
+  (void) name;
+  test_async_t* result = (test_async_t*) userdata;
+  result->called = true;
+  result->has_data = (data != NULL);
+  result->size = size;
+  fs_free(data);
+}
+
+void test_fs_read_async(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd }, .num_threads = 2 });
+
+  /* create a file */
+  const char* str = "The quick brown fox jumps over the lazy dog.";
+  fs_write("is_a_file.txt", FS_DATA_STR_REF(str));
+
+  test_async_t missing = { false }, found = { false };
+
+  TEST_CASE("asynchronously read file that doesn't exist");
+  TEST_CHECK(fs_read_async("not_a_file.txt", test_async_callback, &missing) == true);
+
+  TEST_CASE("asynchronously read file that does exist");
+  TEST_CHECK(fs_read_async("is_a_file.txt", test_async_callback, &found) == true);
+
+  /* pending reads complete before shutdown returns */
+  fs_shutdown();
+
+  TEST_CHECK(missing.called && !missing.has_data);
+  TEST_CHECK(found.called && found.has_data);
+  TEST_CHECK(found.size == strlen(str));
+
+  /* cleanup */
+  remove("is_a_file.txt");
+}
+
+void test_fs_read_threads(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd }, .read_threads = 4 });
+
+  /* create a file large enough to be split */
+  const size_t len = 9 * 1024 * 1024 + 13;
+  char* big = (char*) malloc(len);
+  for (size_t i = 0; i < len; i++) {
+    big[i] = (char) (i * 7);
+  }
+  fs_write("is_a_file.txt", &(fs_data) { big, len });
+
+  TEST_CASE("read large file on several threads");
+  if (TEST_CHECK(fs_exists("is_a_file.txt"))) {
+    size_t size;
+    char* data = fs_read("is_a_file.txt", &size);
+    TEST_CHECK(data != NULL);
+    TEST_CHECK(size == len);
+    TEST_CHECK(memcmp(data, big, len) == 0);
+    fs_free(data);
+  }
+
+  /* cleanup */
+  free(big);
+  fs_delete("is_a_file.txt");
+}
+
+void test_fs_read_direct(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  /* create a file */
+  const char* str = "The quick brown fox jumps over the lazy dog.";
+  fs_write("is_a_file.txt", FS_DATA_STR_REF(str));
+
+  TEST_CASE("read file that doesn't exist");
+  if (TEST_CHECK(!fs_exists("not_a_file.txt"))) {
+    size_t size;
+    TEST_CHECK(fs_read_direct("not_a_file.txt", &size) == NULL);
+  }
+
+  TEST_CASE("read file that does exist");
+  if (TEST_CHECK(fs_exists("is_a_file.txt"))) {
+    size_t size;
+    char* data = fs_read_direct("is_a_file.txt", &size);
+    TEST_CHECK(data != NULL);
+    TEST_CHECK(((uintptr_t) data % 4096) == 0);
+    TEST_CHECK(size == strlen(str));
+    TEST_CHECK(memcmp(data, str, size) == 0);
+    fs_free_aligned(data);
+  }
+
+  /* cleanup */
+  fs_delete("is_a_file.txt");
+}
+
+void test_fs_read_cache(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd }, .cache_size = 64 });
+
+  /* create files */
+  const char* str = "The quick brown fox jumps over the lazy dog.";
+  fs_write("is_a_file.txt", FS_DATA_STR_REF(str));
+  fs_write("is_a_file_too.txt", FS_DATA_STR_REF(str));
+
+  TEST_CASE("read same file twice shares the buffer");
+  size_t size;
+  char* first = fs_read("is_a_file.txt", &size);
+  char* second = fs_read("is_a_file.txt", &size);
+  TEST_CHECK(first != NULL);
+  TEST_CHECK(first == second);
+  TEST_CHECK(size == strlen(str));
+  TEST_CHECK(memcmp(second, str, size) == 0);
+  fs_free(first);
+  fs_free(second);
+
+  TEST_CASE("read file after it was changed");
+  const char* changed = "The five boxing wizards jump quickly.";
+  fs_write("is_a_file.txt", FS_DATA_STR_REF(changed));
+  char* data = fs_read("is_a_file.txt", &size);
+  TEST_CHECK(data != NULL);
+  TEST_CHECK(size == strlen(changed));
+  TEST_CHECK(memcmp(data, changed, size) == 0);
+
+  TEST_CASE("read files larger than the cache");
+  char* other = fs_read("is_a_file_too.txt", &size);
+  TEST_CHECK(other != NULL);
+  TEST_CHECK(_fs.cache.total <= _fs.cache.capacity);
+  fs_free(other);
+  fs_free(data);
+
+  TEST_CASE("read file hidden by a directory in a higher base path");
+  fs_mkdir("is_a_lo_dir");
+  fs_mkdir("is_a_hi_dir/is_a_file.txt");
+  fs_write("is_a_lo_dir/is_a_file.txt", FS_DATA_STR_REF(str));
+  fs_insert_basepath("is_a_lo_dir");
+  fs_insert_basepath("is_a_hi_dir");
+  TEST_CHECK(fs_read("is_a_file.txt", &size) == NULL);
+  fs_remove_basepath("is_a_hi_dir");
+  fs_remove_basepath("is_a_lo_dir");
+  remove("is_a_lo_dir/is_a_file.txt");
+  remove("is_a_hi_dir/is_a_file.txt");
+  remove("is_a_lo_dir");
+  remove("is_a_hi_dir");
+
+  /* cleanup */
+  fs_delete("is_a_file.txt");
+  fs_delete("is_a_file_too.txt");
+  fs_shutdown();
+}
+
+void test_fs_read_into(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  /* create a file */
+  const char* str = "The quick brown fox jumps over the lazy dog.";
+  fs_write("is_a_file.txt", FS_DATA_STR_REF(str));
+
+  char buf[64];
+  size_t size;
+
+  TEST_CASE("read file that doesn't exist");
+  if (TEST_CHECK(!fs_exists("not_a_file.txt"))) {
+    TEST_CHECK(fs_read_into("not_a_file.txt", buf, sizeof(buf), &size) == false);
+  }
+
+  TEST_CASE("read file into a buffer that is too small");
+  if (TEST_CHECK(fs_exists("is_a_file.txt"))) {
+    TEST_CHECK(fs_read_into("is_a_file.txt", buf, 8, &size) == false);
+    TEST_CHECK(size == strlen(str));
+  }
+
+  TEST_CASE("read file into a buffer that is large enough");
+  if (TEST_CHECK(fs_exists("is_a_file.txt"))) {
+    TEST_CHECK(fs_read_into("is_a_file.txt", buf, sizeof(buf), &size) == true);
+    TEST_CHECK(size == strlen(str));
+    TEST_CHECK(memcmp(buf, str, size) == 0);
+  }
+
+  /* cleanup */
+  fs_delete("is_a_file.txt");
+}
+
+void test_fs_read_many(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  /* create files */
+  const char* strs[] = {
+    "The quick brown fox jumps over the lazy dog.",
+    "The five boxing wizards jump quickly.",
+    "",
+  };
+  fs_write("is_a_file.txt", FS_DATA_STR_REF(strs[0]));
+  fs_write("is_a_file_too.txt", FS_DATA_STR_REF(strs[1]));
+
+  const char* names[] = { "is_a_file.txt", "is_a_file_too.txt", "not_a_file.txt" };
+  fs_data results[3];
+
+  TEST_CASE("read a batch of files where one doesn't exist");
+  TEST_CHECK(fs_read_many(names, results, 3) == 2);
+  for (int i = 0; i < 2; i++) {
+    TEST_CHECK(results[i].data != NULL);
+    TEST_CHECK(results[i].size == strlen(strs[i]));
+    TEST_CHECK(memcmp(results[i].data, strs[i], results[i].size) == 0);
+  }
+  TEST_CHECK(results[2].data == NULL);
+  TEST_CHECK(results[2].size == 0);
+
+  TEST_CASE("read a batch of more files than can be open at once");
+  static char many[256][32];
+  const char* ptrs[256];
+  fs_data data[256];
+  for (int i = 0; i < 256; i++) {
+    sprintf(many[i], "is_a_file_%d.txt", i);
+    ptrs[i] = many[i];
+    fs_write(many[i], &(fs_data) { many[i], strlen(many[i]) });
+  }
+  struct rlimit limit;
+  getrlimit(RLIMIT_NOFILE, &limit);
+  struct rlimit lowered = { 64, limit.rlim_max };
+  if (TEST_CHECK(setrlimit(RLIMIT_NOFILE, &lowered) == 0)) {
+    TEST_CHECK(fs_read_many(ptrs, data, 256) == 256);
+    setrlimit(RLIMIT_NOFILE, &limit);
+    for (int i = 0; i < 256; i++) {
+      TEST_CHECK(data[i].size == strlen(many[i]) && memcmp(data[i].data, many[i], data[i].size) == 0);
+      fs_free((void*) data[i].data);
+    }
+  }
+
+  TEST_CASE("read a batch where a higher base path can't be opened");
+  fs_mkdir("is_a_lo_dir");
+  fs_mkdir("is_a_hi_dir");
+  fs_write("is_a_lo_dir/is_a_file.txt", FS_DATA_STR_REF(strs[0]));
+  TEST_CHECK(symlink("is_a_file.txt", "is_a_hi_dir/is_a_file.txt") == 0);
+  fs_insert_basepath("is_a_lo_dir");
+  fs_insert_basepath("is_a_hi_dir");
+  size_t size;
+  const char* looped[] = { "is_a_file.txt" };
+  fs_data result = { NULL, 0 };
+  TEST_CHECK(fs_read("is_a_file.txt", &size) == NULL);
+#if defined(_FS_IO_URING)
+  if (_fs_uring_read_many(looped, &result, 1)) {
+    TEST_CHECK(result.data == NULL);
+  }
+#endif
+  _fs_read_many_t job = { looped, &result };
+  _fs_read_many_one(&job, 0);
+  TEST_CHECK(result.data == NULL);
+  fs_remove_basepath("is_a_hi_dir");
+  fs_remove_basepath("is_a_lo_dir");
+  remove("is_a_hi_dir/is_a_file.txt");
+  remove("is_a_lo_dir/is_a_file.txt");
+  remove("is_a_hi_dir");
+  remove("is_a_lo_dir");
+
+  /* cleanup */
+  for (int i = 0; i < 3; i++) {
+    fs_free((void*) results[i].data);
+  }
+  for (int i = 0; i < 256; i++) {
+    fs_delete(many[i]);
+  }
+  fs_delete("is_a_file.txt");
+  fs_delete("is_a_file_too.txt");
+}
+
+void test_fs_read_range(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  /* create a file */
+  const char* str = "The quick brown fox jumps over the lazy dog.";
+  fs_write("is_a_file.txt", FS_DATA_STR_REF(str));
+
+  size_t size;
+
+  TEST_CASE("read range of file that doesn't exist");
+  if (TEST_CHECK(!fs_exists("not_a_file.txt"))) {
+    TEST_CHECK(fs_read_range("not_a_file.txt", 0, 8, &size) == NULL);
+  }
+
+  TEST_CASE("read range within the file");
+  if (TEST_CHECK(fs_exists("is_a_file.txt"))) {
+    char* data = fs_read_range("is_a_file.txt", 4, 5, &size);
+    TEST_CHECK(data != NULL);
+    TEST_CHECK(size == 5);
+    TEST_CHECK(memcmp(data, "quick", 5) == 0);
+    fs_free(data);
+  }
+
+  TEST_CASE("read range that crosses the end of the file");
+  if (TEST_CHECK(fs_exists("is_a_file.txt"))) {
+    char* data = fs_read_range("is_a_file.txt", 40, 64, &size);
+    TEST_CHECK(data != NULL);
+    TEST_CHECK(size == 4);
+    TEST_CHECK(memcmp(data, "dog.", 4) == 0);
+    fs_free(data);
+  }
+
+  TEST_CASE("read range past the end of the file");
+  if (TEST_CHECK(fs_exists("is_a_file.txt"))) {
+    TEST_CHECK(fs_read_range("is_a_file.txt", 64, 8, &size) == NULL);
+  }
+
+  /* cleanup */
+  fs_delete("is_a_file.txt");
+}
+
+void test_fs_readv(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  /* create a file */
+  const char* str = "The quick brown fox jumps over the lazy dog.";
+  fs_write("is_a_file.txt", FS_DATA_STR_REF(str));
+
+  char first[4], second[6], third[64];
+  fs_buffer buffers[] = {
+    { first, sizeof(first) },
+    { second, sizeof(second) },
+    { third, sizeof(third) },
+  };
+  size_t size;
+
+  TEST_CASE("scatter read of file that doesn't exist");
+  if (TEST_CHECK(!fs_exists("not_a_file.txt"))) {
+    TEST_CHECK(fs_readv("not_a_file.txt", 0, buffers, 3, &size) == false);
+  }
+
+  TEST_CASE("scatter read of file that does exist");
+  if (TEST_CHECK(fs_exists("is_a_file.txt"))) {
+    TEST_CHECK(fs_readv("is_a_file.txt", 0, buffers, 3, &size) == true);
+    TEST_CHECK(size == strlen(str));
+    TEST_CHECK(memcmp(first, "The ", 4) == 0);
+    TEST_CHECK(memcmp(second, "quick ", 6) == 0);
+    TEST_CHECK(memcmp(third, "brown fox", 9) == 0);
+  }
+
+  TEST_CASE("scatter read from an offset");
+  if (TEST_CHECK(fs_exists("is_a_file.txt"))) {
+    TEST_CHECK(fs_readv("is_a_file.txt", 4, buffers, 2, &size) == true);
+    TEST_CHECK(size == 10);
+    TEST_CHECK(memcmp(first, "quic", 4) == 0);
+    TEST_CHECK(memcmp(second, "k brow", 6) == 0);
+  }
+
+  /* cleanup */
+  fs_delete("is_a_file.txt");
+}
+
+void test_fs_records(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  fs_data record;
+
+  TEST_CASE("open records of file that doesn't exist");
+  if (TEST_CHECK(!fs_exists("not_a_file.txt"))) {
+    TEST_CHECK(fs_lines_open("not_a_file.txt") == NULL);
+  }
+
+  TEST_CASE("read lines of a file");
+  const char* str = "The quick brown fox\njumps over\n\nthe lazy dog.";
+  const char* lines[] = { "The quick brown fox", "jumps over", "", "the lazy dog." };
+  fs_write("is_a_file.txt", FS_DATA_STR_REF(str));
+  fs_records* records = fs_lines_open("is_a_file.txt");
+  if (TEST_CHECK(records != NULL)) {
+    int count = 0;
+    while (fs_records_next(records, &record) && count < 4) {
+      TEST_CHECK(record.size == strlen(lines[count]));
+      TEST_CHECK(memcmp(record.data, lines[count], record.size) == 0);
+      count++;
+    }
+    TEST_CHECK(count == 4);
+    fs_records_close(records);
+  }
+
+  TEST_CASE("read records longer than a chunk");
+  static char big[200000];
+  memset(big, 'x', sizeof(big));
+  big[100000] = ',';
+  fs_write("is_a_file.txt", &(fs_data) { big, sizeof(big) });
+  records = fs_records_open("is_a_file.txt", ',');
+  if (TEST_CHECK(records != NULL)) {
+    TEST_CHECK(fs_records_next(records, &record) && record.size == 100000);
+    TEST_CHECK(fs_records_next(records, &record) && record.size == 99999);
+    TEST_CHECK(fs_records_next(records, &record) == false);
+    TEST_CHECK(fs_records_error(records) == false);
+    fs_records_close(records);
+  }
+
+  TEST_CASE("read records of a file that fails");
+  records = fs_lines_open("is_a_file.txt");
+  if (TEST_CHECK(records != NULL)) {
+    /* reading a directory fails with EISDIR */
+    int dir = open(cwd, O_RDONLY);
+    dup2(dir, records->fd);
+    close(dir);
+    TEST_CHECK(fs_records_next(records, &record) == false);
+    TEST_CHECK(fs_records_error(records) == true);
+    fs_records_close(records);
+  }
+
+  /* cleanup */
+  fs_delete("is_a_file.txt");
+}
+
 void test_fs_write(void) {
   /* setup filesystem */
   char* cwd = (char*) fs_get_cwd();
@@ -307,10 +1259,195 @@ void test_fs_write(void) {
     TEST_CHECK(strcmp(data, str) == 0);
   }
 
+  TEST_CASE("write large file that is allocated up front");
+  const size_t len = 3 * 1024 * 1024 + 7;
+  char* big = (char*) calloc(len, 1);
+  TEST_CHECK(fs_write("is_a_file.txt", &(fs_data) { big, len }) == true);
+  fs_info info;
+  TEST_CHECK(fs_get_info("is_a_file.txt", &info) == true);
+  TEST_CHECK(info.size == len);
+  free(big);
+
+  /* cleanup */
+  fs_delete("is_a_file.txt");
+}
+
+void test_fs_write_many(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  TEST_CASE("write many files at once");
+  static char names[100][32];
+  const char* ptrs[100];
+  fs_data data[100];
+  for (int i = 0; i < 100; i++) {
+    sprintf(names[i], "is_a_file_%d.txt", i);
+    ptrs[i] = names[i];
+    data[i] = (fs_data) { names[i], strlen(names[i]) };
+  }
+  TEST_CHECK(fs_write_many(ptrs, data, 100, false) == 100);
+
+  TEST_CASE("write and sync many files at once");
+  TEST_CHECK(fs_write_many(ptrs, data, 100, true) == 100);
+  for (int i = 0; i < 100; i++) {
+    size_t size;
+    char* read = fs_read(names[i], &size);
+    TEST_CHECK(read != NULL && size == strlen(names[i]) && memcmp(read, names[i], size) == 0);
+    fs_free(read);
+  }
+
+  TEST_CASE("write a batch of more files than can be open at once");
+  static char many[256][32];
+  const char* many_ptrs[256];
+  fs_data many_data[256];
+  for (int i = 0; i < 256; i++) {
+    sprintf(many[i], "is_a_many_file_%d.txt", i);
+    many_ptrs[i] = many[i];
+    many_data[i] = (fs_data) { many[i], strlen(many[i]) };
+  }
+  struct rlimit limit;
+  getrlimit(RLIMIT_NOFILE, &limit);
+  struct rlimit lowered = { 64, limit.rlim_max };
+  if (TEST_CHECK(setrlimit(RLIMIT_NOFILE, &lowered) == 0)) {
+    TEST_CHECK(fs_write_many(many_ptrs, many_data, 256, false) == 256);
+    TEST_CHECK(fs_write_many(many_ptrs, many_data, 256, true) == 256);
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+  for (int i = 0; i < 256; i++) {
+    fs_info info;
+    TEST_CHECK(fs_get_info(many[i], &info) == true && info.size == strlen(many[i]));
+    fs_delete(many[i]);
+  }
+
+  TEST_CASE("write many files where some can't be created");
+  const char* mixed[] = { "is_a_file_0.txt", "not_a_dir/is_a_file.txt", "is_a_file_1.txt" };
+  fs_data empty[] = { { NULL, 0 }, { "x", 1 }, { "y", 1 } };
+  TEST_CHECK(fs_write_many(mixed, empty, 3, true) == 2);
+  fs_info info;
+  TEST_CHECK(fs_get_info("is_a_file_0.txt", &info) == true && info.size == 0);
+
+  /* cleanup */
+  for (int i = 0; i < 100; i++) {
+    fs_delete(names[i]);
+  }
+}
+
+void test_fs_write_range(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  /* create a file */
+  const char* str = "The quick brown fox jumps over the lazy dog.";
+  fs_write("is_a_file.txt", FS_DATA_STR_REF(str));
+
+  TEST_CASE("overwrite range inside a file");
+  TEST_CHECK(fs_write_range("is_a_file.txt", 4, &(fs_data) { "slow ", 5 }) == true);
+  TEST_CHECK(fs_write_range("is_a_file.txt", 10, &(fs_data) { "brown", 5 }) == true);
+
+  size_t size;
+  char* data = fs_read("is_a_file.txt", &size);
+  const char* full = "The slow  brown fox jumps over the lazy dog.";
+  TEST_CHECK(data != NULL);
+  TEST_CHECK(size == strlen(full));
+  TEST_CHECK(data && memcmp(data, full, size) == 0);
+  fs_free(data);
+
+  TEST_CASE("write range past the end of a file");
+  TEST_CHECK(fs_write_range("is_a_file.txt", strlen(full) + 2, &(fs_data) { "!", 1 }) == true);
+  data = fs_read("is_a_file.txt", &size);
+  TEST_CHECK(size == strlen(full) + 3);
+  TEST_CHECK(data && data[size - 3] == 0 && data[size - 1] == '!');
+  fs_free(data);
+
+  /* cleanup */
+  fs_delete("is_a_file.txt");
+}
+
+void test_fs_writev(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd } });
+
+  TEST_CASE("write several pieces to a file");
+  fs_data parts[] = { { "The quick", 9 }, { "", 0 }, { " brown fox", 10 }, { " jumps over the lazy dog.", 25 } };
+  TEST_CHECK(fs_writev("is_a_file.txt", parts, 4) == true);
+
+  size_t size;
+  char* data = fs_read("is_a_file.txt", &size);
+  const char* full = "The quick brown fox jumps over the lazy dog.";
+  TEST_CHECK(data != NULL);
+  TEST_CHECK(size == strlen(full));
+  TEST_CHECK(data && memcmp(data, full, size) == 0);
+  fs_free(data);
+
+  TEST_CASE("write more pieces than fit in one call");
+  static fs_data many[200];
+  for (int i = 0; i < 200; i++) {
+    many[i] = (fs_data) { "0123456789", 10 };
+  }
+  TEST_CHECK(fs_writev("is_a_file.txt", many, 200) == true);
+  fs_info info;
+  TEST_CHECK(fs_get_info("is_a_file.txt", &info) == true);
+  TEST_CHECK(info.size == 2000);
+
   /* cleanup */
   fs_delete("is_a_file.txt");
 }
 
+void test_fs_write_async(void) {
+  /* setup filesystem */
+  char* cwd = (char*) fs_get_cwd();
+  fs_setup(&(fs_desc) { .write_dir = cwd, .base_paths = { cwd }, .write_limit = 16 });
+
+  TEST_CASE("write file asynchronously");
+  char str[] = "The quick brown fox jumps over the lazy dog.";
+  TEST_CHECK(fs_write_async("is_a_file.txt", FS_DATA_STR_REF(str)) == true);
+  /* the data was copied */
+  memset(str, 0, sizeof(str));
+  TEST_CHECK(fs_flush() == true);
+
+  size_t size;
+  char* data = fs_read("is_a_file.txt", &size);
+  const char* full = "The quick brown fox jumps over the lazy dog.";
+  TEST_CHECK(data != NULL);
+  TEST_CHECK(size == strlen(full));
+  TEST_CHECK(data && memcmp(data, full, size) == 0);
+  fs_free(data);
+
+  TEST_CASE("append to file asynchronously past the limit");
+  for (int i = 0; i < 100; i++) {
+    TEST_CHECK(fs_append_async("is_a_file.txt", &(fs_data) { "0123456789", 10 }) == true);
+  }
+  TEST_CHECK(fs_flush() == true);
+  fs_info info;
+  TEST_CHECK(fs_get_info("is_a_file.txt", &info) == true);
+  TEST_CHECK(info.size == strlen(full) + 1000);
+
+  TEST_CASE("write file asynchronously that can't be created");
+  TEST_CHECK(fs_write_async("not_a_dir/is_a_file.txt", FS_DATA_STR_REF(full)) == true);
+  TEST_CHECK(fs_flush() == false);
+  TEST_CHECK(fs_flush() == true);
+
+  TEST_CASE("write empty file asynchronously");
+  TEST_CHECK(fs_write_async("is_a_file.txt", &(fs_data) { "", 0 }) == true);
+  TEST_CHECK(fs_flush() == true);
+  TEST_CHECK(fs_get_info("is_a_file.txt", &info) == true);
+  TEST_CHECK(info.size == 0);
+  TEST_CHECK(fs_write_async("not_a_dir/is_a_file.txt", &(fs_data) { "", 0 }) == true);
+  TEST_CHECK(fs_flush() == false);
+
+  TEST_CASE("pending writes complete before shutdown");
+  fs_append_async("is_a_file.txt", &(fs_data) { "0123456789", 10 });
+  fs_shutdown();
+  TEST_CHECK(_fs_get_file_info("is_a_file.txt", &info) == true);
+  TEST_CHECK(info.size == 10);
+
+  /* cleanup */
+  remove("is_a_file.txt");
+}
+
 void test_fs_insert_basepath(void) {
   /* setup filesystem */
   fs_setup(&(fs_desc) {  });
@@ -373,13 +1510,35 @@ TEST_LIST = {
   /* public functions */
   { "fs_setup", test_fs_setup },
   { "fs_append", test_fs_append },
+  { "fs_appender", test_fs_appender },
+  { "fs_copy", test_fs_copy },
   { "fs_delete", test_fs_delete },
   { "fs_exists", test_fs_exists },
   { "fs_get_cwd", test_fs_get_cwd },
   { "fs_get_info", test_fs_get_info },
+  { "fs_hash", test_fs_hash },
+  { "fs_framed", test_fs_framed },
+  { "fs_log", test_fs_log },
+  { "fs_map", test_fs_map },
+  { "fs_map_write", test_fs_map_write },
   { "fs_mkdir", test_fs_mkdir },
+  { "fs_open", test_fs_open },
+  { "fs_prefetch", test_fs_prefetch },
   { "fs_read", test_fs_read },
+  { "fs_read_async", test_fs_read_async },
+  { "fs_read_threads", test_fs_read_threads },
+  { "fs_read_direct", test_fs_read_direct },
+  { "fs_read_cache", test_fs_read_cache },
+  { "fs_read_into", test_fs_read_into },
+  { "fs_read_many", test_fs_read_many },
+  { "fs_read_range", test_fs_read_range },
+  { "fs_readv", test_fs_readv },
+  { "fs_records", test_fs_records },
   { "fs_write", test_fs_write },
+  { "fs_write_async", test_fs_write_async },
+  { "fs_write_many", test_fs_write_many },
+  { "fs_write_range", test_fs_write_range },
+  { "fs_writev", test_fs_writev },
 
   { "fs_insert_basepath", test_fs_insert_basepath },
   { "fs_remove_basepath", test_fs_remove_basepath },
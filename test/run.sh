@@ -5,7 +5,7 @@ curl https://raw.githubusercontent.com/mity/acutest/master/include/acutest.h > a
 
 # build test
 # gcc -o fs_test fs_test.c -I./../src
-gcc -std=c99 -o fs_test fs_test.c -I./../src
+gcc -std=c99 -D_GNU_SOURCE -pthread -o fs_test fs_test.c -I./../src
 
 # run the tests
 echo "testing filesystem..."